@@ -156,6 +156,7 @@ bool IntelMausi::init(OSDictionary *properties)
         txQueue = NULL;
         interruptSource = NULL;
         timerSource = NULL;
+        rxPollSource = NULL;
         netif = NULL;
         netStats = NULL;
         etherStats = NULL;
@@ -165,9 +166,40 @@ bool IntelMausi::init(OSDictionary *properties)
         flashAddr = NULL;
         rxMbufCursor = NULL;
         txMbufCursor = NULL;
+        txBufArray = NULL;
+        rxBufArray = NULL;
+        txRSQueue = NULL;
+        rxPool = NULL;
+        rxPoolHits = 0;
+        rxPoolMisses = 0;
+        rxPoolAllocFails = 0;
+        rxPoolCount = 0;
+        rxPoolTarget = kRxPoolDefSize;
+        rxPoolUsed = 0;
+        rxPoolBurst = 0;
+        rxCopyPackets = 0;
+        rxCopyAllocFails = 0;
+        rxReplacePackets = 0;
+        rxCopyCount = 0;
+        rxCopyBreak = 0;
+        rxBufferSize = kRxBufferPktSize;
+        rxPsHdrDmaCmd = NULL;
+        rxPsHdrBufDesc = NULL;
+        rxPsHdrPhyAddr = 0;
+        rxPsHdrBuffer = NULL;
+        rxPsDescArray = NULL;
+        rxPsPageArray = NULL;
+        rxSplitPackets = 0;
+        rxPsPages = 0;
+        rxPsDiscard = false;
+        numTxDesc = kNumTxDescDef;
+        numRxDesc = kNumRxDescDef;
+        txDescMask = numTxDesc - 1;
+        rxDescMask = numRxDesc - 1;
         rxPacketHead = NULL;
         rxPacketTail = NULL;
         rxPacketSize = 0;
+        rxDiscard = false;
         mcAddrList = NULL;
         mcListCount = 0;
         isEnabled = false;
@@ -194,7 +226,51 @@ bool IntelMausi::init(OSDictionary *properties)
         wolCapable = false;
         wolActive = false;
         wolPwrOff = true;
-        enableCSO6 = false;
+        enableCSO6 = true;
+        enableTSO4 = false;
+        enableTSO6 = false;
+        forceTSO = false;
+        txTsoActive = false;
+        enableRSBatching = true;
+        enableTxInlineReclaim = false;
+        enableTxByteLimit = true;
+        enablePacketSplit = false;
+        enableCacheableRings = false;
+        enableAdaptiveITR = false;
+        itrRate = 0;
+        rxItrClass = low_latency;
+        txItrClass = low_latency;
+        itrConservative = false;
+        rxPollPasses = 0;
+        rxPollBudget = 0;
+        rxPolling = false;
+        enableAdaptivePolling = false;
+        pollBias = kPollBiasDef;
+        txIntrMasked = false;
+        bzero(&txBql, sizeof(struct IntelByteQueueLimit));
+        nanoseconds_to_absolutetime((UInt64)kTxBqlHoldTimeMS * 1000000ULL, &txBqlHoldTime);
+        txReclaimLock = NULL;
+        txCtxValid = false;
+        bzero(&txBurstHist, sizeof(struct IntelHistogram));
+        bzero(&txReclaimHist, sizeof(struct IntelHistogram));
+        bzero(&rxTailHist, sizeof(struct IntelHistogram));
+        bzero(&rxTopFlows, sizeof(struct IntelFlowTable));
+        bzero(&intrDurationHist, sizeof(struct IntelHistogram));
+        bzero(&rxPassHist, sizeof(struct IntelHistogram));
+        bzero(&txPassHist, sizeof(struct IntelHistogram));
+        bzero(intrCauses, sizeof(intrCauses));
+        rxTailUrgent = 0;
+        txDeferredDescs = 0;
+        txDeferredPkts = 0;
+        txDoorbellsSaved = 0;
+        txCopyDmaCmd = NULL;
+        txCopyBufDesc = NULL;
+        txCopyBuffer = NULL;
+        txCopyPhyAddr = 0;
+        txCopyPackets = 0;
+        txSoftChecksums = 0;
+        txTsoFallbacks = 0;
+        txCopyBreak = 0;
         pciPMCtrlOffset = 0;
         maxLatency = 0;
         debugger = NULL;
@@ -220,6 +296,10 @@ void IntelMausi::free()
             workLoop->removeEventSource(timerSource);
             RELEASE(timerSource);
         }
+        if (rxPollSource) {
+            workLoop->removeEventSource(rxPollSource);
+            RELEASE(rxPollSource);
+        }
         workLoop->release();
         workLoop = NULL;
     }
@@ -241,6 +321,11 @@ void IntelMausi::free()
     RELEASE(pciDevice);
     freeDMADescriptors();
 
+    if (txReclaimLock) {
+        IOLockFree(txReclaimLock);
+        txReclaimLock = NULL;
+    }
+
     if (mcAddrList) {
         IOFree(mcAddrList, mcListCount * sizeof(IOEthernetAddress));
         mcAddrList = NULL;
@@ -284,9 +369,27 @@ bool IntelMausi::start(IOService *provider)
     }
     getParams();
 
+    txReclaimLock = IOLockAlloc();
+
+    if (!txReclaimLock) {
+        IOLog("[IntelMausi]: Couldn't alloc txReclaimLock.\n");
+        goto error2;
+    }
     if (!intelStart()) {
         goto error2;
     }
+    /*
+     * SPT/KBL have TSO errata (see e1000e). With forceTSO TSO is used anyway
+     * relying on the TARC0_CB_MULTIQ_2_REQ workaround in intelConfigureTx().
+     */
+    if (forceTSO)
+        adapterData.flags |= FLAG_TSO_FORCE;
+
+    if ((adapterData.hw.mac.type == e1000_pch_spt) && !(adapterData.flags & FLAG_TSO_FORCE) &&
+        (enableTSO4 || enableTSO6)) {
+        IOLog("[IntelMausi]: TSO disabled due to hardware issues. Set forceTSO to enable it.\n");
+        enableTSO4 = enableTSO6 = false;
+    }
     if (!setupMediumDict()) {
         IOLog("[IntelMausi]: Failed to setup medium dictionary.\n");
         goto error2;
@@ -362,6 +465,10 @@ void IntelMausi::stop(IOService *provider)
             workLoop->removeEventSource(timerSource);
             RELEASE(timerSource);
         }
+        if (rxPollSource) {
+            workLoop->removeEventSource(rxPollSource);
+            RELEASE(rxPollSource);
+        }
         workLoop->release();
         workLoop = NULL;
     }
@@ -555,12 +662,23 @@ bool IntelMausi::isKdpPacket(UInt8 *data, UInt32 len)
     return true;
 }
 
+/*
+ * Receive descriptor at index in the current mode. The write-back status
+ * is located at the same offset in extended and packet split descriptors.
+ */
+inline union e1000_rx_desc_extended *IntelMausi::intelRxDesc(UInt32 index)
+{
+    return (rxPsPages) ? (union e1000_rx_desc_extended *)&rxPsDescArray[index] : &rxDescArray[index];
+}
+
 void IntelMausi::receivePacket(void *pkt, UInt32 *pktSizeOut, UInt32 timeout)
 {
-    union e1000_rx_desc_extended *desc = &rxDescArray[rxNextDescIndex];
+    union e1000_rx_desc_extended *desc = intelRxDesc(rxNextDescIndex);
+    union e1000_rx_desc_packet_split *psDesc;
     mbuf_t bufPkt;
     UInt64 addr;
     UInt32 pktSize;
+    UInt32 hdrSize;
     bool isReceived = false;
     UInt32 costTime = 0;
 
@@ -579,6 +697,25 @@ void IntelMausi::receivePacket(void *pkt, UInt32 *pktSizeOut, UInt32 timeout)
             bufPkt = rxBufArray[rxNextDescIndex].mbuf;
             pktSize = OSSwapLittleToHostInt16(desc->wb.upper.length);
 
+            if (rxPsPages) {
+                /* With packet split the header buffer comes first, followed by the first page. */
+                psDesc = (union e1000_rx_desc_packet_split *)desc;
+                hdrSize = OSSwapLittleToHostInt16(psDesc->wb.middle.length0);
+                pktSize = OSSwapLittleToHostInt16(psDesc->wb.upper.length[0]);
+
+                if ((hdrSize + pktSize) <= KDP_MAXPACKET) {
+                    memcpy(pkt, rxPsHdrBuffer + rxNextDescIndex * kRxPsHdrSize, hdrSize);
+                    memcpy((UInt8 *)pkt + hdrSize, mbuf_data(bufPkt), pktSize);
+
+                    if (isKdpPacket((UInt8 *)pkt, hdrSize + pktSize)) {
+                        *pktSizeOut = hdrSize + pktSize;
+                        isReceived = true;
+                    }
+                }
+                intelRxPsDescInit(rxNextDescIndex);
+                goto nextDesc;
+            }
+
             /* Copy current packet to KDP if it is valid, otherwise discard. */
             if (pktSize > 0 && pktSize <= KDP_MAXPACKET) {
                 uint32_t counter = 0;
@@ -610,8 +747,9 @@ void IntelMausi::receivePacket(void *pkt, UInt32 *pktSizeOut, UInt32 timeout)
             desc->read.buffer_addr = OSSwapHostToLittleInt64(addr);
             desc->read.reserved = 0;
 
-            ++rxNextDescIndex &= kRxDescMask;
-            desc = &rxDescArray[rxNextDescIndex];
+        nextDesc:
+            ++rxNextDescIndex &= rxDescMask;
+            desc = intelRxDesc(rxNextDescIndex);
             rxCleanedCount++;
         }
 
@@ -620,41 +758,16 @@ void IntelMausi::receivePacket(void *pkt, UInt32 *pktSizeOut, UInt32 timeout)
             costTime += 10;
         }
     }
-
-    if (rxCleanedCount >= E1000_RX_BUFFER_WRITE) {
-        /*
-         * Prevent the tail from reaching the head in order to avoid a false
-         * buffer queue full condition.
-         */
-        if (adapterData.flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
-            intelUpdateRxDescTail((rxNextDescIndex - 1) & kRxDescMask);
-        else
-            intelWriteMem32(E1000_RDT(0), (rxNextDescIndex - 1) & kRxDescMask);
-
-        rxCleanedCount = 0;
-    }
+    /* Hand the buffers back right away as the debugger polls one packet at a time. */
+    intelRxUpdateTail(true);
 }
 
 void IntelMausi::sendPacket(void *pkt, UInt32 pktSize)
 {
     IOPhysicalSegment txSegments[kMaxSegs];
-    struct e1000_data_desc *desc;
-    struct e1000_context_desc *contDesc;
+    struct intelTxDescSetup setup;
     mbuf_t m;
-    UInt32 numDescs;
-    UInt32 cmd;
-    UInt32 opts;
-    UInt32 word2;
-    UInt32 len;
-    UInt32 mss;
-    UInt32 ipConfig;
-    UInt32 tcpConfig;
-    UInt32 word1;
     UInt32 numSegs;
-    UInt32 lastSeg;
-    UInt32 index;
-    UInt32 offloadFlags;
-    UInt16 vlanTag;
     UInt16 i;
 
     /* WARNING: This routine is NOT allowed to allocate memory or block the thread (e.g. use mutexes, IOSleep). */
@@ -700,70 +813,11 @@ void IntelMausi::sendPacket(void *pkt, UInt32 pktSize)
         return;
     }
 
-    numDescs = 0;
-    cmd = 0;
-    opts = (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS);
-    word2 = 0;
-    len = 0;
-    mss = 0;
-    ipConfig = 0;
-    tcpConfig = 0;
-    offloadFlags = 0;
-
-    /* First prepare the header and the command bits. */
-    mbuf_get_csum_requested(m, &offloadFlags, &mss);
-
-    if (offloadFlags & (kChecksumUDPIPv6 | kChecksumTCPIPv6 | kChecksumIP | kChecksumUDP | kChecksumTCP)) {
-        numDescs = 1;
-        cmd = (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D);
-
-        if (offloadFlags & kChecksumTCP) {
-            ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-            tcpConfig = ((kTCPv4CSumEnd << 16) | (kTCPv4CSumOffset << 8) | kTCPv4CSumStart);
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP | E1000_TXD_CMD_TCP);
-            mss = 0;
-
-            word2 = (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM);
-        } else if (offloadFlags & kChecksumUDP) {
-            ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-            tcpConfig = ((kUDPv4CSumEnd << 16) | (kUDPv4CSumOffset << 8) | kUDPv4CSumStart);
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP);
-            mss = 0;
-
-            word2 = (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM);
-        } else if (offloadFlags & kChecksumIP) {
-            ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-            tcpConfig = 0;
-            mss = 0;
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP);
-
-            word2 = E1000_TXD_OPTS_IXSM;
-        } else if (offloadFlags & kChecksumTCPIPv6) {
-            ipConfig = ((kIPv6CSumEnd << 16) | (kIPv6CSumOffset << 8) | kIPv6CSumStart);
-            tcpConfig = ((kTCPv6CSumEnd << 16) | (kTCPv6CSumOffset << 8) | kTCPv6CSumStart);
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_TCP);
-            mss = 0;
-
-            word2 = E1000_TXD_OPTS_TXSM;
-        } else if (offloadFlags & kChecksumUDPIPv6) {
-            ipConfig = ((kIPv6CSumEnd << 16) | (kIPv6CSumOffset << 8) | kIPv6CSumStart);
-            tcpConfig = ((kUDPv6CSumEnd << 16) | (kUDPv6CSumOffset << 8) | kUDPv6CSumStart);
-            len = E1000_TXD_CMD_DEXT;
-            mss = 0;
-
-            word2 = E1000_TXD_OPTS_TXSM;
-        }
-    }
-
-    /* Next get the VLAN tag and command bit. */
-    if (!mbuf_get_vlan_tag(m, &vlanTag)) {
-        opts |= E1000_TXD_CMD_VLE;
-        word2 |= (vlanTag << E1000_TX_FLAGS_VLAN_SHIFT);
-    }
+    /* First prepare the header and the command bits. Debugger packets never request TSO. */
+    intelSetupTxDesc(&m, &setup);
 
     /* Finally get the physical segments. */
     numSegs = txMbufCursor->getPhysicalSegmentsWithCoalesce(m, &txSegments[0], kMaxSegs);
-    numDescs += numSegs;
 
     if (!numSegs) {
         DebugLog("[IntelMausi]: getPhysicalSegmentsWithCoalesce() failed. Dropping packet.\n");
@@ -771,48 +825,7 @@ void IntelMausi::sendPacket(void *pkt, UInt32 pktSize)
         freePacketEx(m, kDelayFree);
         return;
     }
-
-    OSAddAtomic(-numDescs, &txNumFreeDesc);
-    index = txNextDescIndex;
-    txNextDescIndex = (txNextDescIndex + numDescs) & kTxDescMask;
-    lastSeg = numSegs - 1;
-
-    /* Setup the context descriptor for TSO or checksum offload. */
-    if (offloadFlags) {
-        contDesc = (struct e1000_context_desc *)&txDescArray[index];
-
-        txBufArray[index].mbuf = NULL;
-        txBufArray[index].numDescs = 0;
-
-        contDesc->lower_setup.ip_config = OSSwapHostToLittleInt32(ipConfig);
-        contDesc->upper_setup.tcp_config = OSSwapHostToLittleInt32(tcpConfig);
-        contDesc->cmd_and_length = OSSwapHostToLittleInt32(len);
-        contDesc->tcp_seg_setup.data = OSSwapHostToLittleInt32(mss);
-
-        ++index &= kTxDescMask;
-    }
-
-    /* And finally fill in the data descriptors. */
-    for (i = 0; i < numSegs; i++) {
-        desc = &txDescArray[index];
-        word1 = (cmd | (txSegments[i].length & 0x000fffff));
-
-        if (i == lastSeg) {
-            word1 |= opts;
-            txBufArray[index].mbuf = m;
-            txBufArray[index].numDescs = numDescs;
-        } else {
-            txBufArray[index].mbuf = NULL;
-            txBufArray[index].numDescs = 0;
-        }
-
-        desc->buffer_addr = OSSwapHostToLittleInt64(txSegments[i].location);
-        desc->lower.data = OSSwapHostToLittleInt32(word1);
-        desc->upper.data = OSSwapHostToLittleInt32(word2);
-
-        ++index &= kTxDescMask;
-    }
-
+    intelFillTxDescs(m, &setup, &txSegments[0], numSegs);
     intelUpdateTxDescTail(txNextDescIndex);
 }
 
@@ -892,6 +905,11 @@ IOReturn IntelMausi::driverDisable()
     timerSource->cancelTimeout();
     txDescDoneCount = txDescDoneLast = 0;
 
+#ifndef __PRIVATE_SPI__
+    rxPollSource->cancelTimeout();
+    rxPolling = false;
+#endif /* __PRIVATE_SPI__ */
+
     /* We are using MSI so that we have to disable the interrupt. */
     interruptSource->disable();
 
@@ -915,159 +933,76 @@ done:
 
 IOReturn IntelMausi::outputStart(IONetworkInterface *interface, IOOptionBits options)
 {
-    IOPhysicalSegment txSegments[kMaxSegs];
-    struct e1000_data_desc *desc;
-    struct e1000_context_desc *contDesc;
+    IOPhysicalSegment txSegments[kMaxSegs + kMaxSplitSegs];
+    struct intelTxDescSetup setup;
+    mbuf_t pktList;
     mbuf_t m;
     IOReturn result = kIOReturnNoResources;
-    UInt32 numDescs;
-    UInt32 cmd;
-    UInt32 opts;
-    UInt32 word2;
-    UInt32 len;
-    UInt32 mss;
-    UInt32 ipConfig;
-    UInt32 tcpConfig;
-    UInt32 word1;
     UInt32 numSegs;
-    UInt32 lastSeg;
-    UInt32 index;
-    UInt32 offloadFlags;
-    UInt16 vlanTag;
-    UInt16 i;
+    UInt32 burstSize;
     UInt16 count;
 
     //DebugLog("[IntelMausi]: outputStart() ===>\n");
-    count = 0;
 
     if (!(isEnabled && linkUp) || forceReset) {
         DebugLog("[IntelMausi]: Interface down. Dropping packets.\n");
         goto done;
     }
-    while ((txNumFreeDesc >= (kMaxSegs + kTxSpareDescs)) && (interface->dequeueOutputPackets(1, &m, NULL, NULL, NULL) == kIOReturnSuccess)) {
-        numDescs = 0;
-        cmd = 0;
-        opts = (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS);
-        word2 = 0;
-        len = 0;
-        mss = 0;
-        ipConfig = 0;
-        tcpConfig = 0;
-        offloadFlags = 0;
-
-        /* First prepare the header and the command bits. */
-        mbuf_get_csum_requested(m, &offloadFlags, &mss);
-
-        if (offloadFlags & (kChecksumUDPIPv6 | kChecksumTCPIPv6 | kChecksumIP | kChecksumUDP | kChecksumTCP)) {
-            numDescs = 1;
-            cmd = (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D);
-
-            if (offloadFlags & kChecksumTCP) {
-                ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-                tcpConfig = ((kTCPv4CSumEnd << 16) | (kTCPv4CSumOffset << 8) | kTCPv4CSumStart);
-                len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP | E1000_TXD_CMD_TCP);
-                mss = 0;
-
-                word2 = (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM);
-            } else if (offloadFlags & kChecksumUDP) {
-                ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-                tcpConfig = ((kUDPv4CSumEnd << 16) | (kUDPv4CSumOffset << 8) | kUDPv4CSumStart);
-                len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP);
-                mss = 0;
-
-                word2 = (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM);
-            } else if (offloadFlags & kChecksumIP) {
-                ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-                tcpConfig = 0;
-                mss = 0;
-                len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP);
-
-                word2 = E1000_TXD_OPTS_IXSM;
-            } else if (offloadFlags & kChecksumTCPIPv6) {
-                ipConfig = ((kIPv6CSumEnd << 16) | (kIPv6CSumOffset << 8) | kIPv6CSumStart);
-                tcpConfig = ((kTCPv6CSumEnd << 16) | (kTCPv6CSumOffset << 8) | kTCPv6CSumStart);
-                len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_TCP);
-                mss = 0;
-
-                word2 = E1000_TXD_OPTS_TXSM;
-            } else if (offloadFlags & kChecksumUDPIPv6) {
-                ipConfig = ((kIPv6CSumEnd << 16) | (kIPv6CSumOffset << 8) | kIPv6CSumStart);
-                tcpConfig = ((kUDPv6CSumEnd << 16) | (kUDPv6CSumOffset << 8) | kUDPv6CSumStart);
-                len = E1000_TXD_CMD_DEXT;
-                mss = 0;
-
-                word2 = E1000_TXD_OPTS_TXSM;
-            }
-        }
-
-        /* Next get the VLAN tag and command bit. */
-        if (!mbuf_get_vlan_tag(m, &vlanTag)) {
-            opts |= E1000_TXD_CMD_VLE;
-            word2 |= (vlanTag << E1000_TX_FLAGS_VLAN_SHIFT);
-        }
-        /* Finally get the physical segments. */
-        numSegs = txMbufCursor->getPhysicalSegmentsWithCoalesce(m, &txSegments[0], kMaxSegs);
-        numDescs += numSegs;
+    if (enableTxInlineReclaim)
+        intelTxReclaimInline();
 
-        if (!numSegs) {
-            DebugLog("[IntelMausi]: getPhysicalSegmentsWithCoalesce() failed. Dropping packet.\n");
-            etherStats->dot3TxExtraEntry.resourceErrors++;
-            freePacket(m);
-            continue;
-        }
-        OSAddAtomic(-numDescs, &txNumFreeDesc);
-        index = txNextDescIndex;
-        txNextDescIndex = (txNextDescIndex + numDescs) & kTxDescMask;
-        lastSeg = numSegs - 1;
+    while ((txNumFreeDesc >= (kMaxSegs + kTxSpareDescs)) && intelTxBqlAvail()) {
+        /*
+         * Dequeue as many packets as fit into the ring even in the worst
+         * case because packets can't be put back into the output queue.
+         */
+        burstSize = (txNumFreeDesc - kTxSpareDescs) / (kMaxSegs + kMaxSplitSegs + 1);
 
-        /* Setup the context descriptor for checksum offload. */
-        if (offloadFlags) {
-            contDesc = (struct e1000_context_desc *)&txDescArray[index];
+        if (burstSize == 0)
+            burstSize = 1;
 
-            txBufArray[index].mbuf = NULL;
-            txBufArray[index].numDescs = 0;
+        if (interface->dequeueOutputPackets(burstSize, &pktList, NULL, &burstSize, NULL) != kIOReturnSuccess)
+            break;
 
-#ifdef DEBUG
-            txBufArray[index].pad = numSegs;
-#endif
+        intelHistogramAdd(&txBurstHist, burstSize);
+        count = 0;
 
-            contDesc->lower_setup.ip_config = OSSwapHostToLittleInt32(ipConfig);
-            contDesc->upper_setup.tcp_config = OSSwapHostToLittleInt32(tcpConfig);
-            contDesc->cmd_and_length = OSSwapHostToLittleInt32(len);
-            contDesc->tcp_seg_setup.data = OSSwapHostToLittleInt32(mss);
+        while (pktList) {
+            m = pktList;
+            pktList = mbuf_nextpkt(m);
+            mbuf_setnextpkt(m, NULL);
 
-            ++index &= kTxDescMask;
-        }
-        /* And finally fill in the data descriptors. */
-        for (i = 0; i < numSegs; i++) {
-            desc = &txDescArray[index];
-            word1 = (cmd | (txSegments[i].length & 0x000fffff));
-
-            if (i == lastSeg) {
-                word1 |= opts;
-                txBufArray[index].mbuf = m;
-                txBufArray[index].numDescs = numDescs;
+            /* First prepare the header and the command bits. */
+            if (!intelSetupTxDesc(&m, &setup)) {
+                etherStats->dot3TxExtraEntry.resourceErrors++;
+                continue;
+            }
+            /* Copy small packets into the bounce buffer of their data descriptor. */
+            if (intelTxCopyable(m, &setup)) {
+                intelCopyTxPacket(m, ((txNextDescIndex + setup.numDescs) & txDescMask), &txSegments[0]);
+                freePacket(m);
+                m = NULL;
+                numSegs = 1;
             } else {
-                txBufArray[index].mbuf = NULL;
-                txBufArray[index].numDescs = 0;
+                numSegs = intelMapTxSegments(m, &setup, &txSegments[0]);
             }
-
-#ifdef DEBUG
-            txBufArray[index].pad = (UInt32)txSegments[i].length;
-#endif
-
-            desc->buffer_addr = OSSwapHostToLittleInt64(txSegments[i].location);
-            desc->lower.data = OSSwapHostToLittleInt32(word1);
-            desc->upper.data = OSSwapHostToLittleInt32(word2);
-
-            ++index &= kTxDescMask;
+            if (!numSegs) {
+                DebugLog("[IntelMausi]: getPhysicalSegmentsWithCoalesce() failed. Dropping packet.\n");
+                etherStats->dot3TxExtraEntry.resourceErrors++;
+                freePacket(m);
+                continue;
+            }
+            intelFillTxDescs(m, &setup, &txSegments[0], numSegs);
+            count++;
         }
-        count++;
-    }
-    if (count)
-        intelUpdateTxDescTail(txNextDescIndex);
+        /* Ring the doorbell once per burst. */
+        if (count)
+            intelUpdateTxDescTail(txNextDescIndex);
 
-    result = (txNumFreeDesc >= (kMaxSegs + kTxSpareDescs)) ? kIOReturnSuccess : kIOReturnNoResources;
+        if (enableTxInlineReclaim)
+            intelTxReclaimInline();
+    }
+    result = ((txNumFreeDesc >= (kMaxSegs + kTxSpareDescs)) && intelTxBqlAvail()) ? kIOReturnSuccess : kIOReturnNoResources;
 
     //DebugLog("[IntelMausi]: outputStart() <===\n");
 
@@ -1079,25 +1014,12 @@ done:
 
 UInt32 IntelMausi::outputPacket(mbuf_t m, void *param)
 {
-    IOPhysicalSegment txSegments[kMaxSegs];
-    struct e1000_data_desc *desc;
-    struct e1000_context_desc *contDesc;
+    IOPhysicalSegment txSegments[kMaxSegs + kMaxSplitSegs];
+    struct intelTxDescSetup setup;
     UInt32 result = kIOReturnOutputDropped;
-    UInt32 numDescs = 0;
-    UInt32 cmd = 0;
-    UInt32 opts = (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS);
-    UInt32 word2 = 0;
-    UInt32 len = 0;
-    UInt32 mss = 0;
-    UInt32 ipConfig = 0;
-    UInt32 tcpConfig = 0;
-    UInt32 word1;
+    UInt32 numDescs;
     UInt32 numSegs;
-    UInt32 lastSeg;
-    UInt32 index;
-    UInt32 offloadFlags = 0;
-    UInt16 vlanTag;
-    UInt16 i;
+    bool copyPkt;
 
     //DebugLog("[IntelMausi]: outputPacket() ===>\n");
 
@@ -1105,157 +1027,69 @@ UInt32 IntelMausi::outputPacket(mbuf_t m, void *param)
         DebugLog("[IntelMausi]: Interface down. Dropping packet.\n");
         goto error;
     }
-    if (mbuf_get_tso_requested(m, &offloadFlags, &mss)) {
-        DebugLog("[IntelMausi]: mbuf_get_tso_requested() failed. Dropping packet.\n");
+    if (enableTxInlineReclaim)
+        intelTxReclaimInline();
+
+    /*
+     * Check for resources before the packet is touched. A stalled packet is
+     * handed back to the output queue, but the header preparation below may
+     * replace or free the mbuf. Like outputStart() reserve room for the worst
+     * case, kTxSpareDescs covers the context descriptor and split segments.
+     */
+    if (txNumFreeDesc < (kMaxSegs + kTxSpareDescs)) {
+        DebugLog("[IntelMausi]: Not enough descriptors. Stalling.\n");
+        result = kIOReturnOutputStall;
+        stalled = true;
         goto done;
     }
-    /* First prepare the header and the command bits. */
-    mbuf_get_csum_requested(m, &offloadFlags, &mss);
-
-    if (offloadFlags & (kChecksumUDPIPv6 | kChecksumTCPIPv6 | kChecksumIP | kChecksumUDP | kChecksumTCP)) {
-        numDescs = 1;
-        cmd = (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D);
-
-        if (offloadFlags & kChecksumTCP) {
-            ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-            tcpConfig = ((kTCPv4CSumEnd << 16) | (kTCPv4CSumOffset << 8) | kTCPv4CSumStart);
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP | E1000_TXD_CMD_TCP);
-            mss = 0;
-
-            word2 = (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM);
-        } else if (offloadFlags & kChecksumUDP) {
-            ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-            tcpConfig = ((kUDPv4CSumEnd << 16) | (kUDPv4CSumOffset << 8) | kUDPv4CSumStart);
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP);
-            mss = 0;
-
-            word2 = (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM);
-        } else if (offloadFlags & kChecksumIP) {
-            ipConfig = ((kIPv4CSumEnd << 16) | (kIPv4CSumOffset << 8) | kIPv4CSumStart);
-            tcpConfig = 0;
-            mss = 0;
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP);
-
-            word2 = E1000_TXD_OPTS_IXSM;
-        } else if (offloadFlags & kChecksumTCPIPv6) {
-            ipConfig = ((kIPv6CSumEnd << 16) | (kIPv6CSumOffset << 8) | kIPv6CSumStart);
-            tcpConfig = ((kTCPv6CSumEnd << 16) | (kTCPv6CSumOffset << 8) | kTCPv6CSumStart);
-            len = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_TCP);
-            mss = 0;
-
-            word2 = E1000_TXD_OPTS_TXSM;
-        } else if (offloadFlags & kChecksumUDPIPv6) {
-            ipConfig = ((kIPv6CSumEnd << 16) | (kIPv6CSumOffset << 8) | kIPv6CSumStart);
-            tcpConfig = ((kUDPv6CSumEnd << 16) | (kUDPv6CSumOffset << 8) | kUDPv6CSumStart);
-            len = E1000_TXD_CMD_DEXT;
-            mss = 0;
-
-            word2 = E1000_TXD_OPTS_TXSM;
-        }
+    /* Stall the queue as well when the byte queue limit has been reached. */
+    if (!intelTxBqlAvail()) {
+        result = kIOReturnOutputStall;
+        stalled = true;
+        goto done;
     }
-    /* Next get the VLAN tag and command bit. */
-    if (!mbuf_get_vlan_tag(m, &vlanTag)) {
-        opts |= E1000_TXD_CMD_VLE;
-        word2 |= (vlanTag << E1000_TX_FLAGS_VLAN_SHIFT);
+    /*
+     * From now on the packet is either sent or dropped.
+     * First prepare the header and the command bits.
+     */
+    if (!intelSetupTxDesc(&m, &setup)) {
+        etherStats->dot3TxExtraEntry.resourceErrors++;
+        goto done;
     }
-    /* Finally get the physical segments. */
-    numSegs = txMbufCursor->getPhysicalSegmentsWithCoalesce(m, &txSegments[0], kMaxSegs);
-    numDescs += numSegs;
+    /* Small packets are copied into the bounce buffer of their data descriptor. */
+    copyPkt = intelTxCopyable(m, &setup);
+    numSegs = copyPkt ? 1 : intelMapTxSegments(m, &setup, &txSegments[0]);
 
     if (!numSegs) {
         DebugLog("[IntelMausi]: getPhysicalSegmentsWithCoalesce() failed. Dropping packet.\n");
         etherStats->dot3TxExtraEntry.resourceErrors++;
         goto error;
     }
-    /* Alloc required number of descriptors. We leave at least kTxSpareDescs unused. */
-    if ((txNumFreeDesc <= (numDescs + kTxSpareDescs))) {
-        DebugLog("[IntelMausi]: Not enough descriptors. Stalling.\n");
-        result = kIOReturnOutputStall;
-        stalled = true;
-        goto done;
-    }
-    OSAddAtomic(-numDescs, &txNumFreeDesc);
-    index = txNextDescIndex;
-    txNextDescIndex = (txNextDescIndex + numDescs) & kTxDescMask;
-    lastSeg = numSegs - 1;
-
-    /* Setup the context descriptor for TSO or checksum offload. */
-    if (offloadFlags) {
-        contDesc = (struct e1000_context_desc *)&txDescArray[index];
-
-        txBufArray[index].mbuf = NULL;
-        txBufArray[index].numDescs = 0;
+    numDescs = setup.numDescs + numSegs;
 
-#ifdef DEBUG
-        txBufArray[index].pad = 0;
-#endif
-
-        contDesc->lower_setup.ip_config = OSSwapHostToLittleInt32(ipConfig);
-        contDesc->upper_setup.tcp_config = OSSwapHostToLittleInt32(tcpConfig);
-        contDesc->cmd_and_length = OSSwapHostToLittleInt32(len);
-        contDesc->tcp_seg_setup.data = OSSwapHostToLittleInt32(mss);
-
-        ++index &= kTxDescMask;
+    if (copyPkt) {
+        intelCopyTxPacket(m, ((txNextDescIndex + setup.numDescs) & txDescMask), &txSegments[0]);
+        freePacket(m);
+        m = NULL;
     }
-    /* And finally fill in the data descriptors. */
-    if (offloadFlags & (MBUF_TSO_IPV4 | MBUF_TSO_IPV6)) {
-        for (i = 0; i < numSegs; i++) {
-            desc = &txDescArray[index];
-            word1 = (cmd | (txSegments[i].length & 0x000fffff));
-
-            if (i == 0) {
-                word1 |= opts;
-                txBufArray[index].mbuf = NULL;
-                txBufArray[index].numDescs = 0;
-            } else if (i == lastSeg) {
-                word1 |= (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_RS);
-                txBufArray[index].mbuf = m;
-                txBufArray[index].numDescs = numDescs;
-            } else {
-                txBufArray[index].mbuf = NULL;
-                txBufArray[index].numDescs = 0;
-            }
-
-#ifdef DEBUG
-            txBufArray[index].pad = (UInt32)txSegments[i].length;
-#endif
-
-            desc->buffer_addr = OSSwapHostToLittleInt64(txSegments[i].location);
-            desc->lower.data = OSSwapHostToLittleInt32(word1);
-            desc->upper.data = OSSwapHostToLittleInt32(word2);
-
-            ++index &= kTxDescMask;
-        }
-    } else {
-        for (i = 0; i < numSegs; i++) {
-            desc = &txDescArray[index];
-            word1 = (cmd | (txSegments[i].length & 0x000fffff));
-
-            if (i == lastSeg) {
-                word1 |= opts;
-                txBufArray[index].mbuf = m;
-                txBufArray[index].numDescs = numDescs;
-            } else {
-                txBufArray[index].mbuf = NULL;
-                txBufArray[index].numDescs = 0;
-            }
+    intelFillTxDescs(m, &setup, &txSegments[0], numSegs);
 
-#ifdef DEBUG
-            txBufArray[index].pad = (UInt32)txSegments[i].length;
-#endif
+    if (!txDeferredDescs)
+        clock_get_uptime(&txDeferredStart);
 
-            desc->buffer_addr = OSSwapHostToLittleInt64(txSegments[i].location);
-            desc->lower.data = OSSwapHostToLittleInt32(word1);
-            desc->upper.data = OSSwapHostToLittleInt32(word2);
-
-            ++index &= kTxDescMask;
-        }
-    }
-    intelUpdateTxDescTail(txNextDescIndex);
+    txDeferredDescs += numDescs;
+    txDeferredPkts++;
 
     result = kIOReturnOutputSuccess;
 
 done:
+    /*
+     * Update the tail pointer only when the queue has been drained, the
+     * queue is going to stall or one of the thresholds has been reached.
+     */
+    if (txDeferredDescs && ((result == kIOReturnOutputStall) || intelTxDoorbellDue()))
+        intelFlushTxDoorbell();
+
     //DebugLog("[IntelMausi]: outputPacket() <===\n");
 
     return result;
@@ -1265,6 +1099,26 @@ error:
     goto done;
 }
 
+bool IntelMausi::intelTxDoorbellDue()
+{
+    UInt64 now;
+
+    if ((txQueue->getSize() == 0) || (txDeferredDescs >= txDoorbellDescs))
+        return true;
+
+    clock_get_uptime(&now);
+
+    return ((now - txDeferredStart) >= txDoorbellTime);
+}
+
+void IntelMausi::intelFlushTxDoorbell()
+{
+    intelUpdateTxDescTail(txNextDescIndex);
+
+    txDoorbellsSaved += (txDeferredPkts - 1);
+    txDeferredDescs = txDeferredPkts = 0;
+}
+
 #endif /* __PRIVATE_SPI__ */
 
 void IntelMausi::getPacketBufferConstraints(IOPacketBufferConstraints *constraints) const
@@ -1353,7 +1207,7 @@ bool IntelMausi::configureInterface(IONetworkInterface *interface)
         result = false;
         goto done;
     }
-    error = interface->configureInputPacketPolling(kNumRxDesc, kIONetworkWorkLoopSynchronous);
+    error = interface->configureInputPacketPolling(numRxDesc, kIONetworkWorkLoopSynchronous);
 
     if (error != kIOReturnSuccess) {
         IOLog("[IntelMausi]: configureInputPacketPolling() failed\n.");
@@ -1507,6 +1361,12 @@ UInt32 IntelMausi::getFeatures() const
 
     DebugLog("[IntelMausi]: getFeatures() ===>\n");
 
+    if (enableTSO4)
+        features |= kIONetworkFeatureTSOIPv4;
+
+    if (enableTSO6)
+        features |= kIONetworkFeatureTSOIPv6;
+
     DebugLog("[IntelMausi]: getFeatures() <===\n");
 
     return features;
@@ -1653,6 +1513,7 @@ IOReturn IntelMausi::getMaxPacketSize(UInt32 * maxSize) const
 IOReturn IntelMausi::setMaxPacketSize(UInt32 maxSize)
 {
     IOReturn result = kIOReturnError;
+    UInt32 pages;
 
     DebugLog("[IntelMausi]: setMaxPacketSize() ===>\n");
 
@@ -1660,6 +1521,20 @@ IOReturn IntelMausi::setMaxPacketSize(UInt32 maxSize)
         mtu = maxSize - (ETH_HLEN + ETH_FCS_LEN);
         adapterData.max_frame_size = maxSize;
 
+        /* Jumbo frames use 4K buffers, see intelResizeRxBuffers(). */
+        adapterData.rx_buffer_len = ((maxSize + kVlanHdrLen) > kRxBufferPktSize) ? kRxJumboBufferSize : kRxBufferPktSize;
+
+        /*
+         * Like e1000e we use packet split for jumbo frames only, with
+         * jumbo buffers as pages, see intelSetupRxPsMode().
+         */
+        pages = (maxSize + kVlanHdrLen + kRxJumboBufferSize - 1) / kRxJumboBufferSize;
+
+        if (enablePacketSplit && rxPsDescArray && (adapterData.rx_buffer_len == kRxJumboBufferSize) && (pages <= PS_PAGE_BUFFERS))
+            adapterData.rx_ps_pages = pages;
+        else
+            adapterData.rx_ps_pages = 0;
+
         DebugLog("[IntelMausi]: maxSize: %u, mtu: %u\n", maxSize, mtu);
 
         /* Force reinitialization. */
@@ -1676,269 +1551,1132 @@ IOReturn IntelMausi::setMaxPacketSize(UInt32 maxSize)
     return result;
 }
 
-#pragma mark --- common interrupt methods ---
+/*
+ * Change the interrupt moderation at runtime. The keys of the
+ * coalescing dictionary published in the registry are accepted with
+ * the semantics of ethtool's set_coalesce, see intelSetCoalesce().
+ * Any other keys are left to our superclass.
+ */
+IOReturn IntelMausi::setProperties(OSObject *properties)
+{
+    OSDictionary *dict = OSDynamicCast(OSDictionary, properties);
+    IOReturn result = kIOReturnUnsupported;
+    UInt32 numKeys = 0;
+
+    if (dict) {
+        numKeys += (dict->getObject(kRxCoalesceUsecsName) != NULL);
+        numKeys += (dict->getObject(kRxDelayTimeName) != NULL);
+        numKeys += (dict->getObject(kRxAbsTimeName) != NULL);
+        numKeys += (dict->getObject(kTxDelayTimeName) != NULL);
+        numKeys += (dict->getObject(kTxAbsTimeName) != NULL);
+    }
+    if (!numKeys)
+        return super::setProperties(properties);
 
-void IntelMausi::txInterrupt(IOOptionBits options)
+    if (commandGate) {
+        result = IOUserClient::clientHasPrivilege(current_task(), kIOClientPrivilegeAdministrator);
+
+        if (result == kIOReturnSuccess)
+            result = commandGate->runAction(setCoalesceAction, dict);
+    }
+    if ((result == kIOReturnSuccess) && (dict->getCount() > numKeys))
+        super::setProperties(properties);
+
+    return result;
+}
+
+IOReturn IntelMausi::setCoalesceAction(OSObject *owner, void *arg1, void *arg2, void *arg3, void *arg4)
 {
-    UInt32 descStatus;
-    SInt32 cleaned;
+    IntelMausi *ethCtlr = OSDynamicCast(IntelMausi, owner);
+    IOReturn result = kIOReturnError;
 
-    while (txDirtyIndex != txCleanBarrierIndex) {
-        if (txBufArray[txDirtyIndex].mbuf) {
-            descStatus = OSSwapLittleToHostInt32(txDescArray[txDirtyIndex].upper.data);
+    if (ethCtlr)
+        result = ethCtlr->intelSetCoalesce((OSDictionary *)arg1);
 
-            if (!(descStatus & E1000_TXD_STAT_DD))
-                goto done;
+    return result;
+}
 
-            /* First free the attached mbuf and clean up the buffer info. */
-            freePacketEx(txBufArray[txDirtyIndex].mbuf, options);
-            txBufArray[txDirtyIndex].mbuf = NULL;
+/*
+ * Apply new coalescing parameters, runs on the workloop.
+ *
+ * rxCoalesceUsecs controls ITR like ethtool's rx-usecs: 0 disables
+ * throttling, 1 selects adaptive moderation, 3 its conservative variant
+ * and 10 to 10000 a fixed interval in us. 2 and 4 to 9 are invalid as
+ * e1000e's simplified mode 4 depends on MSI-X. The rx delays are in
+ * units of 1.024 us and apply to the current link speed, or to all
+ * speeds while the link is down, tx delays to all speeds. Like ethtool
+ * the request is rejected as a whole when one of the values is out of
+ * range. The values are always stored but the registers are only
+ * written while the interface is running, setLinkUp() reprograms them.
+ */
+IOReturn IntelMausi::intelSetCoalesce(OSDictionary *dict)
+{
+    OSNumber *itrNum = OSDynamicCast(OSNumber, dict->getObject(kRxCoalesceUsecsName));
+    OSNumber *rxDelayNum = OSDynamicCast(OSNumber, dict->getObject(kRxDelayTimeName));
+    OSNumber *rxAbsNum = OSDynamicCast(OSNumber, dict->getObject(kRxAbsTimeName));
+    OSNumber *txDelayNum = OSDynamicCast(OSNumber, dict->getObject(kTxDelayTimeName));
+    OSNumber *txAbsNum = OSDynamicCast(OSNumber, dict->getObject(kTxAbsTimeName));
+    UInt32 *thrValue[3], *rxDelay[3], *rxAbs[3];
+    UInt32 numSpeeds = 1;
+    UInt32 usecs = 0;
+    UInt32 i;
+    bool running = (isEnabled && linkUp);
+    IOReturn result = kIOReturnUnsupported;
 
-            cleaned = txBufArray[txDirtyIndex].numDescs;
-            txBufArray[txDirtyIndex].numDescs = 0;
+    if (!(itrNum || rxDelayNum || rxAbsNum || txDelayNum || txAbsNum))
+        goto done;
 
-            /* Finally update the number of free descriptors. */
-            OSAddAtomic(cleaned, &txNumFreeDesc);
-            txDescDoneCount += cleaned;
-        }
-        /* Increment txDirtyIndex. */
-        ++txDirtyIndex &= kTxDescMask;
-    }
+    result = kIOReturnBadArgument;
 
-    //DebugLog("[IntelMausi]: txInterrupt oldIndex=%u newIndex=%u\n", oldDirtyIndex, txDirtyDescIndex);
+    if (itrNum) {
+        usecs = itrNum->unsigned32BitValue();
 
-done:
-#ifdef __PRIVATE_SPI__
-    if (txNumFreeDesc > kTxQueueWakeTreshhold)
-        netif->signalOutputThread();
-#else
-    if (stalled && (txNumFreeDesc > kTxQueueWakeTreshhold)) {
-        DebugLog("[IntelMausi]: Restart stalled queue!\n");
-        txQueue->service(IOBasicOutputQueue::kServiceAsync);
-        stalled = false;
+        if ((usecs > E1000_MAX_ITR_USECS) || ((usecs > 3) && (usecs < E1000_MIN_ITR_USECS)) || (usecs == 2))
+            goto done;
     }
-    etherStats->dot3TxExtraEntry.interrupts++;
-#endif /* __PRIVATE_SPI__ */
-}
+    if ((rxDelayNum && (rxDelayNum->unsigned32BitValue() > kRxDelayTimeMax)) ||
+        (rxAbsNum && (rxAbsNum->unsigned32BitValue() > kRxAbsTimeMax)) ||
+        (txDelayNum && (txDelayNum->unsigned32BitValue() > kTxDelayTimeMax)) ||
+        (txAbsNum && (txAbsNum->unsigned32BitValue() > kTxAbsTimeMax)))
+        goto done;
 
-#ifdef __PRIVATE_SPI__
+    /* The rx parameters belong to a link speed. */
+    if (linkUp) {
+        intelGetSpeedCoalesce(&thrValue[0], &rxDelay[0], &rxAbs[0]);
+    } else {
+        thrValue[0] = &intrThrValue1000;
+        rxDelay[0] = &rxDelayTime1000;
+        rxAbs[0] = &rxAbsTime1000;
+        thrValue[1] = &intrThrValue100;
+        rxDelay[1] = &rxDelayTime100;
+        rxAbs[1] = &rxAbsTime100;
+        thrValue[2] = &intrThrValue10;
+        rxDelay[2] = &rxDelayTime10;
+        rxAbs[2] = &rxAbsTime10;
+        numSpeeds = 3;
+    }
+    if (itrNum) {
+        if ((usecs == 1) || (usecs == 3)) {
+            itrConservative = (usecs == 3);
 
-UInt32 IntelMausi::rxInterrupt(IONetworkInterface *interface, uint32_t maxCount, IOMbufQueue *pollQueue, void *context)
+            if (!enableAdaptiveITR) {
+                /* The counters aren't kept while adaptive moderation is off. */
+                adapterData.total_tx_bytes = adapterData.total_tx_packets = 0;
+                adapterData.total_rx_bytes = adapterData.total_rx_packets = 0;
+
+                enableAdaptiveITR = true;
+                itrRate = 20000;
+                rxItrClass = txItrClass = low_latency;
+
+                if (running && (adapterData.link_speed == SPEED_1000))
+                    intelWriteMem32(E1000_ITR, 1000000000 / (itrRate * 256));
+            }
+        } else {
+            enableAdaptiveITR = false;
+            itrRate = 0;
+
+            for (i = 0; i < numSpeeds; i++)
+                *thrValue[i] = (usecs * 1000) / 256;
+
+            if (running)
+                intelWriteMem32(E1000_ITR, *thrValue[0]);
+        }
+    }
+    if (rxDelayNum) {
+        for (i = 0; i < numSpeeds; i++)
+            *rxDelay[i] = rxDelayNum->unsigned32BitValue();
+
+        if (running) {
+            adapterData.rx_int_delay = *rxDelay[0];
+            intelWriteMem32(E1000_RDTR, adapterData.rx_int_delay);
+        }
+    }
+    if (rxAbsNum) {
+        for (i = 0; i < numSpeeds; i++)
+            *rxAbs[i] = rxAbsNum->unsigned32BitValue();
+
+        if (running) {
+            adapterData.rx_abs_int_delay = *rxAbs[0];
+            intelWriteMem32(E1000_RADV, adapterData.rx_abs_int_delay);
+        }
+    }
+    if (txDelayNum) {
+        adapterData.tx_int_delay = txDelayNum->unsigned32BitValue();
+
+        if (running)
+            intelWriteMem32(E1000_TIDV, adapterData.tx_int_delay);
+    }
+    if (txAbsNum) {
+        adapterData.tx_abs_int_delay = txAbsNum->unsigned32BitValue();
+
+        if (running)
+            intelWriteMem32(E1000_TADV, adapterData.tx_abs_int_delay);
+    }
+    publishCoalescing();
+    result = kIOReturnSuccess;
+
+    DebugLog("[IntelMausi]: Coalescing set to rx-usecs=%u, rdtr=%u, radv=%u, tidv=%u, tadv=%u.\n", (itrNum) ? usecs : ~0U, *rxDelay[0], *rxAbs[0], adapterData.tx_int_delay, adapterData.tx_abs_int_delay);
+
+done:
+    return result;
+}
+
+/* Get the per speed moderation settings of the current link speed. */
+void IntelMausi::intelGetSpeedCoalesce(UInt32 **thrValue, UInt32 **rxDelay, UInt32 **rxAbs)
+{
+    if (adapterData.link_speed == SPEED_1000) {
+        *thrValue = &intrThrValue1000;
+        *rxDelay = &rxDelayTime1000;
+        *rxAbs = &rxAbsTime1000;
+    } else if (adapterData.link_speed == SPEED_100) {
+        *thrValue = &intrThrValue100;
+        *rxDelay = &rxDelayTime100;
+        *rxAbs = &rxAbsTime100;
+    } else {
+        *thrValue = &intrThrValue10;
+        *rxDelay = &rxDelayTime10;
+        *rxAbs = &rxAbsTime10;
+    }
+}
+
+#pragma mark --- common interrupt methods ---
+
+/* The packet and byte counters of intelSetItr() are only kept while it is in use. */
+inline bool IntelMausi::intelItrActive()
+{
+    return (enableAdaptiveITR && (adapterData.link_speed == SPEED_1000));
+}
+
+void IntelMausi::txInterrupt(IOOptionBits options)
+{
+    mbuf_t m;
+    mbuf_t freeList = NULL;
+    UInt32 descStatus;
+    UInt32 numPkts = 0;
+    UInt32 numBytes = 0;
+    UInt16 rsIndex;
+    UInt16 endIndex;
+    SInt32 cleaned = 0;
+    bool freeBulk;
+
+    /*
+     * Completed packets are collected in a list and released at once. In
+     * case the debugger is active they have to go through freePacketEx()
+     * in order to refill the kdp buffer pool.
+     */
+    freeBulk = (!hasDebugger && !options);
+
+    /*
+     * Only descriptors with the RS bit set report their status. Once one of
+     * them is done, all descriptors up to it can be reclaimed without
+     * checking them individually.
+     */
+    while (txRSHead != txRSTail) {
+        rsIndex = txRSQueue[txRSHead];
+        descStatus = OSSwapLittleToHostInt32(txDescArray[rsIndex].upper.data);
+
+        if (!(descStatus & E1000_TXD_STAT_DD))
+            break;
+
+        endIndex = (rsIndex + 1) & txDescMask;
+
+        while (txDirtyIndex != endIndex) {
+            /* Packets copied into a bounce buffer have already been freed. */
+            if (txBufArray[txDirtyIndex].numDescs) {
+                /* First free the attached mbuf and clean up the buffer info. */
+                m = txBufArray[txDirtyIndex].mbuf;
+
+                if (m) {
+                    if (freeBulk) {
+                        mbuf_setnextpkt(m, freeList);
+                        freeList = m;
+                    } else {
+                        freePacketEx(m, options);
+                    }
+                    txBufArray[txDirtyIndex].mbuf = NULL;
+                }
+                cleaned += txBufArray[txDirtyIndex].numDescs;
+                numBytes += txBufArray[txDirtyIndex].numBytes;
+                txBufArray[txDirtyIndex].numDescs = 0;
+                numPkts++;
+            }
+            /* Increment txDirtyIndex. */
+            ++txDirtyIndex &= txDescMask;
+        }
+        ++txRSHead &= txDescMask;
+    }
+    if (freeList)
+        mbuf_freem_list(freeList);
+
+    /* Finally update the number of free descriptors. */
+    if (cleaned) {
+        OSAddAtomic(cleaned, &txNumFreeDesc);
+        txDescDoneCount += cleaned;
+        intelHistogramAdd(&txReclaimHist, numPkts);
+        intelHistogramAdd(&txPassHist, cleaned);
+        intelTxBqlCompleted(numBytes);
+
+        /* Serialized by txReclaimLock or the workloop, see intelSetItr(). */
+        if (intelItrActive()) {
+            adapterData.total_tx_packets += numPkts;
+            adapterData.total_tx_bytes += numBytes;
+        }
+    }
+
+    //DebugLog("[IntelMausi]: txInterrupt oldIndex=%u newIndex=%u\n", oldDirtyIndex, txDirtyDescIndex);
+
+#ifdef __PRIVATE_SPI__
+    if ((txNumFreeDesc > kTxQueueWakeTreshhold) && intelTxBqlAvail())
+        netif->signalOutputThread();
+#else
+    if (stalled && (txNumFreeDesc > kTxQueueWakeTreshhold) && intelTxBqlAvail()) {
+        DebugLog("[IntelMausi]: Restart stalled queue!\n");
+        txQueue->service(IOBasicOutputQueue::kServiceAsync);
+        stalled = false;
+    }
+#endif /* __PRIVATE_SPI__ */
+}
+
+/* Reclaim tx descriptors from the workloop. */
+void IntelMausi::intelTxReclaim()
+{
+    if (enableTxInlineReclaim) {
+        IOLockLock(txReclaimLock);
+        txInterrupt();
+        IOLockUnlock(txReclaimLock);
+    } else {
+        txInterrupt();
+    }
+}
+
+/*
+ * Reclaim tx descriptors from the transmit path unless the workloop is
+ * already doing it. The tx interrupt is only needed when the number of
+ * free descriptors falls below kTxIntrLowWater.
+ */
+void IntelMausi::intelTxReclaimInline()
+{
+    bool mask;
+
+    if (IOLockTryLock(txReclaimLock)) {
+        txInterrupt();
+        IOLockUnlock(txReclaimLock);
+    }
+    /* A queue stopped by the byte queue limit needs the interrupt to restart. */
+    mask = ((txNumFreeDesc >= kTxIntrLowWater) && intelTxBqlAvail());
+
+    /*
+     * The flag and the mask register are changed together under the lock
+     * as interruptOccurred() rearms IMS depending on txIntrMasked.
+     */
+    if (mask != txIntrMasked) {
+        IOLockLock(txReclaimLock);
+        txIntrMasked = mask;
+        intelWriteMem32(mask ? E1000_IMC : E1000_IMS, E1000_IMS_TXDW);
+        IOLockUnlock(txReclaimLock);
+    }
+}
+
+/*
+ * Byte queue limits: the number of bytes handed to the hardware is limited
+ * to the amount it is able to send between two reclaims, which keeps the
+ * queueing latency in the ring low. The limit is adjusted on completion
+ * following dql_completed() of the Linux kernel. It's increased when the
+ * hardware ran out of work and decreased by the lowest slack observed
+ * during kTxBqlHoldTimeMS.
+ */
+void IntelMausi::intelTxBqlReset()
+{
+    bzero(&txBql, sizeof(struct IntelByteQueueLimit));
+    txBql.limit = kTxBqlMinLimit;
+    txBql.adjLimit = kTxBqlMinLimit;
+    txBql.lowestSlack = 0xffffffff;
+    clock_get_uptime(&txBql.slackStart);
+}
+
+inline void IntelMausi::intelTxBqlQueued(UInt32 bytes)
+{
+    txBql.lastObjCnt = bytes;
+    txBql.numQueued += bytes;
+}
+
+inline bool IntelMausi::intelTxBqlAvail()
+{
+    return (!enableTxByteLimit || ((SInt32)(txBql.adjLimit - txBql.numQueued) >= 0));
+}
+
+#define BQL_POSDIFF(a, b) (((SInt32)((a) - (b)) > 0) ? ((a) - (b)) : 0)
+
+void IntelMausi::intelTxBqlCompleted(UInt32 bytes)
+{
+    UInt64 now;
+    UInt32 numQueued = txBql.numQueued;
+    UInt32 completed = txBql.numCompleted + bytes;
+    UInt32 limit = txBql.limit;
+    UInt32 ovLimit = BQL_POSDIFF(numQueued - txBql.numCompleted, limit);
+    UInt32 inProgress = numQueued - completed;
+    UInt32 prevInProgress = txBql.prevNumQueued - txBql.numCompleted;
+    UInt32 slack, slackLastObjs;
+    bool allPrevCompleted = ((SInt32)(completed - txBql.prevNumQueued) >= 0);
+
+    if ((ovLimit && !inProgress) || (txBql.prevOvLimit && allPrevCompleted)) {
+        /*
+         * The queue was starved: either it ran empty while being over
+         * the limit or everything queued until the last completion has
+         * been sent while being over the limit.
+         */
+        limit += BQL_POSDIFF(completed, txBql.prevNumQueued) + txBql.prevOvLimit;
+        clock_get_uptime(&txBql.slackStart);
+        txBql.lowestSlack = 0xffffffff;
+    } else if (inProgress && prevInProgress && !allPrevCompleted) {
+        /*
+         * The hardware didn't run out of work so that the limit might be
+         * too high. Remember the lowest excess and remove it from the
+         * limit after the hold time.
+         */
+        slack = BQL_POSDIFF(limit + txBql.prevOvLimit, 2 * (completed - txBql.numCompleted));
+        slackLastObjs = txBql.prevOvLimit ? BQL_POSDIFF(txBql.prevLastObjCnt, txBql.prevOvLimit) : 0;
+
+        if (slackLastObjs > slack)
+            slack = slackLastObjs;
+
+        if (slack < txBql.lowestSlack)
+            txBql.lowestSlack = slack;
+
+        clock_get_uptime(&now);
+
+        if ((now - txBql.slackStart) > txBqlHoldTime) {
+            limit = BQL_POSDIFF(limit, txBql.lowestSlack);
+            txBql.slackStart = now;
+            txBql.lowestSlack = 0xffffffff;
+        }
+    }
+    if (limit < kTxBqlMinLimit)
+        limit = kTxBqlMinLimit;
+    else if (limit > kTxBqlMaxLimit)
+        limit = kTxBqlMaxLimit;
+
+    if (limit != txBql.limit) {
+        txBql.limit = limit;
+        ovLimit = 0;
+    }
+    txBql.adjLimit = limit + completed;
+    txBql.prevOvLimit = ovLimit;
+    txBql.prevLastObjCnt = txBql.lastObjCnt;
+    txBql.numCompleted = completed;
+    txBql.prevNumQueued = numQueued;
+}
+
+/*
+ * Hand over the packet received into the receive buffer buf and put a
+ * new buffer into its place. Pre-mapped buffers are taken from the
+ * recycle pool so that neither an allocation nor a mapping is required.
+ * Only in case the pool has run dry replaceOrCopyPacket() is used. Returns
+ * NULL in case the buffer had to be left in place.
+ */
+inline mbuf_t IntelMausi::intelReplaceRxBuffer(struct intelRxBufferInfo *buf, UInt32 pktSize, UInt64 *addr)
+{
+    IOPhysicalSegment rxSegment;
+    mbuf_t bufPkt = buf->mbuf;
+    mbuf_t newPkt;
+    bool replaced = false;
+
+    if (rxPoolCount) {
+        newPkt = bufPkt;
+        *buf = rxPool[--rxPoolCount];
+        *addr = buf->phyAddr;
+        replaced = true;
+        rxPoolUsed++;
+        rxPoolHits++;
+        goto done;
+    }
+    rxPoolMisses++;
+    newPkt = replaceOrCopyPacket(&bufPkt, pktSize, &replaced);
+
+    if (!newPkt) {
+        /* Allocation of a new packet failed so that we must leave the original packet in place. */
+        rxPoolAllocFails++;
+        goto done;
+    }
+    /* If the packet was replaced we have to update the descriptor's buffer address. */
+    if (replaced) {
+        if ((rxMbufCursor->getPhysicalSegments(bufPkt, &rxSegment, 1) != 1) || (rxSegment.location & 0x07ff)) {
+            DebugLog("[IntelMausi]: getPhysicalSegments() failed.\n");
+            freePacketEx(bufPkt);
+            newPkt = NULL;
+            goto done;
+        }
+        *addr = rxSegment.location;
+        buf->mbuf = bufPkt;
+        buf->phyAddr = rxSegment.location;
+    }
+
+done:
+    /* Packets copied by replaceOrCopyPacket() don't count as replaced. */
+    if (newPkt && replaced)
+        rxReplacePackets++;
+
+    return newPkt;
+}
+
+/*
+ * Copy a packet below the copybreak threshold into a small mbuf from the
+ * copybreak pool so that the receive buffer stays on the ring. Returns
+ * NULL in case the pool is empty.
+ */
+inline mbuf_t IntelMausi::intelCopyRxPacket(UInt32 index, UInt32 pktSize)
+{
+    mbuf_t m = NULL;
+
+    if (rxCopyCount) {
+        m = rxCopyPool[--rxCopyCount];
+        rxCopyPool[rxCopyCount] = NULL;
+        memcpy(mbuf_data(m), mbuf_data(rxBufArray[index].mbuf), pktSize);
+        rxCopyPackets++;
+    }
+    return m;
+}
+
+/*
+ * Top up the recycle pool once it has been drained to half of its target
+ * size. The buffers are allocated in one go and mapped in advance, away
+ * from the receive loop.
+ */
+void IntelMausi::intelRxPoolRefill()
 {
     IOPhysicalSegment rxSegment;
+    mbuf_t list = NULL;
+    mbuf_t m;
+    unsigned int maxChunks = 1;
+
+    if (rxPoolUsed > rxPoolBurst)
+        rxPoolBurst = rxPoolUsed;
+
+    rxPoolUsed = 0;
+
+    if (!rxPool || (rxPoolCount >= (rxPoolTarget >> 1)))
+        return;
+
+    if (mbuf_allocpacket_list(rxPoolTarget - rxPoolCount, MBUF_DONTWAIT, rxBufferSize, &maxChunks, &list)) {
+        rxPoolAllocFails++;
+        return;
+    }
+    while (list) {
+        m = list;
+        list = mbuf_nextpkt(m);
+        mbuf_setnextpkt(m, NULL);
+        mbuf_setlen(m, rxBufferSize);
+        mbuf_pkthdr_setlen(m, rxBufferSize);
+
+        if ((rxMbufCursor->getPhysicalSegments(m, &rxSegment, 1) != 1) || (rxSegment.location & 0x07ff)) {
+            rxPoolAllocFails++;
+            freePacket(m);
+            continue;
+        }
+        rxPool[rxPoolCount].mbuf = m;
+        rxPool[rxPoolCount].phyAddr = rxSegment.location;
+        rxPoolCount++;
+    }
+}
+
+/*
+ * Top up the copybreak pool once half of it has been used.
+ */
+void IntelMausi::intelRxCopyRefill()
+{
+    mbuf_t list = NULL;
+    mbuf_t m;
+    unsigned int maxChunks = 1;
+
+    if (!rxCopyBreak || (rxCopyCount >= (kRxCopyPoolSize >> 1)))
+        return;
+
+    if (mbuf_allocpacket_list(kRxCopyPoolSize - rxCopyCount, MBUF_DONTWAIT, rxCopyBreak, &maxChunks, &list)) {
+        rxCopyAllocFails++;
+        return;
+    }
+    while (list) {
+        m = list;
+        list = mbuf_nextpkt(m);
+        mbuf_setnextpkt(m, NULL);
+        rxCopyPool[rxCopyCount++] = m;
+    }
+}
+
+void IntelMausi::freeRxCopyPool()
+{
+    while (rxCopyCount > 0) {
+        freePacket(rxCopyPool[--rxCopyCount]);
+        rxCopyPool[rxCopyCount] = NULL;
+    }
+}
+
+/*
+ * Called once per timer period: the target size of the recycle pool
+ * follows twice the largest number of buffers consumed between two
+ * refills. Buffers in excess of it are released.
+ */
+void IntelMausi::intelRxPoolAdjust()
+{
+    mbuf_t list = NULL;
+    mbuf_t m;
+    UInt32 target = rxPoolBurst << 1;
+
+    if (target < kRxPoolMinSize)
+        target = kRxPoolMinSize;
+    else if (target > numRxDesc)
+        target = numRxDesc;
+
+    rxPoolTarget = target;
+    rxPoolBurst = 0;
+
+    while (rxPoolCount > target) {
+        m = rxPool[--rxPoolCount].mbuf;
+        rxPool[rxPoolCount].mbuf = NULL;
+        mbuf_setnextpkt(m, list);
+        list = m;
+    }
+    if (list)
+        mbuf_freem_list(list);
+}
+
+/* First phase of receive, see intelRxHarvestDescs(). */
+inline UInt32 IntelMausi::intelRxHarvest(struct intelRxBatchEntry *batch, UInt32 limit)
+{
+    if (limit > kRxBatchSize)
+        limit = kRxBatchSize;
+
+    return intelRxHarvestDescs(rxDescArray, rxBufArray, rxNextDescIndex, rxDescMask, batch, limit);
+}
+
+/*
+ * Return the cleaned descriptors to the NIC. Without pending packets the
+ * NIC has filled all descriptors up to rxNextDescIndex, so that it owns at
+ * most those which haven't been cleaned. In case this has dropped to the
+ * RDMTS threshold of half the ring, or there are more packets pending, all
+ * cleaned descriptors are returned at once. Otherwise the tail update is
+ * deferred until a batch has built up whose size grows with the number of
+ * descriptors the NIC has consumed, so that a lightly loaded ring gets its
+ * buffers back soon while a busy one saves register writes. RDH is only
+ * read in case a batch between kRxTailMinBatch and kRxTailMaxBatch might
+ * be due, i.e. at most once per pass and not at all for small passes.
+ */
+inline void IntelMausi::intelRxUpdateTail(bool pending)
+{
+    UInt32 tail = (rxNextDescIndex - 1 - rxCleanedCount) & rxDescMask;
+    UInt32 rdmts = numRxDesc >> 1;
+    UInt32 hwFree = numRxDesc - 1 - rxCleanedCount;
+    UInt32 batch;
+
+    if (!rxCleanedCount)
+        return;
+
+    if (pending || (hwFree <= rdmts)) {
+        rxTailUrgent++;
+    } else if (rxCleanedCount < kRxTailMinBatch) {
+        return;
+    } else if (rxCleanedCount < kRxTailMaxBatch) {
+        /* Packets which arrived after the pass count as consumed too. */
+        hwFree = (tail - intelReadMem32(E1000_RDH(0))) & rxDescMask;
+
+        if (hwFree <= rdmts) {
+            rxTailUrgent++;
+        } else {
+            batch = (numRxDesc - 1 - hwFree) >> 2;
+
+            if (batch < kRxTailMinBatch)
+                batch = kRxTailMinBatch;
+
+            if (rxCleanedCount < batch)
+                return;
+        }
+    }
+    intelHistogramAdd(&rxTailHist, rxCleanedCount);
+
+    /*
+     * Prevent the tail from reaching the head in order to avoid a false
+     * buffer queue full condition.
+     */
+    intelDescBarrier();
+
+    if (adapterData.flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
+        intelUpdateRxDescTail((rxNextDescIndex - 1) & rxDescMask);
+    else
+        intelWriteMem32(E1000_RDT(0), (rxNextDescIndex - 1) & rxDescMask);
+
+    rxCleanedCount = 0;
+}
+
+/*
+ * Refresh the buffer addresses of packet split descriptor index as they
+ * are overwritten on descriptor writeback. Unused pages get a null pointer.
+ */
+void IntelMausi::intelRxPsDescInit(UInt32 index)
+{
+    union e1000_rx_desc_packet_split *desc = &rxPsDescArray[index];
+    struct intelRxBufferInfo *page = &rxPsPageArray[index * (PS_PAGE_BUFFERS - 1)];
+    UInt32 i;
+
+    desc->read.buffer_addr[0] = OSSwapHostToLittleInt64(rxPsHdrPhyAddr + index * kRxPsHdrSize);
+    desc->read.buffer_addr[1] = OSSwapHostToLittleInt64(rxBufArray[index].phyAddr);
+
+    for (i = 1; i < PS_PAGE_BUFFERS; i++)
+        desc->read.buffer_addr[i + 1] = (i < rxPsPages) ? OSSwapHostToLittleInt64(page[i - 1].phyAddr) : ~0ULL;
+}
+
+/*
+ * Build a packet from the header buffer and the pages of packet split
+ * descriptor index. Like e1000e, a small payload is copied behind the
+ * header so that the page stays on the ring. Returns NULL in case the
+ * packet has been dropped.
+ */
+mbuf_t IntelMausi::intelRxPsPacket(UInt32 index, union e1000_rx_desc_packet_split *desc, UInt32 status)
+{
+    struct intelRxBufferInfo *page;
+    mbuf_t pkt = NULL;
+    mbuf_t tail;
+    mbuf_t m;
+    UInt64 addr;
+    UInt32 hdrSize = OSSwapLittleToHostInt16(desc->wb.middle.length0);
+    UInt32 pktSize;
+    UInt32 len;
+    UInt32 i;
+
+    /* A packet must fit into the buffers of one descriptor, see setMaxPacketSize(). */
+    if (!(status & E1000_RXD_STAT_EOP))
+        rxPsDiscard = true;
+
+    if (rxPsDiscard) {
+        DebugLog("[IntelMausi]: Packet split buffers didn't pick up the full packet.\n");
+
+        if (status & E1000_RXD_STAT_EOP)
+            rxPsDiscard = false;
+
+        etherStats->dot3StatsEntry.internalMacReceiveErrors++;
+        goto done;
+    }
+    /* Skip bad packet. */
+    if ((status & E1000_RXDEXT_ERR_FRAME_ERR_MASK) || !hdrSize || (hdrSize > kRxPsHdrSize)) {
+        DebugLog("[IntelMausi]: Bad packet.\n");
+        etherStats->dot3StatsEntry.internalMacReceiveErrors++;
+        goto done;
+    }
+    /* The header is copied into a small mbuf, preferably one from the copybreak pool. */
+    if (rxCopyCount && (rxCopyBreak >= kRxPsHdrSize)) {
+        pkt = rxCopyPool[--rxCopyCount];
+        rxCopyPool[rxCopyCount] = NULL;
+    } else {
+        pkt = allocatePacket(kRxPsHdrSize);
+
+        if (!pkt)
+            goto nomem;
+    }
+    memcpy(mbuf_data(pkt), rxPsHdrBuffer + index * kRxPsHdrSize, hdrSize);
+    pktSize = hdrSize;
+    len = OSSwapLittleToHostInt16(desc->wb.upper.length[0]);
+
+    if (len && (len <= rxCopyBreak) && ((hdrSize + len) <= kRxPsHdrSize)) {
+        memcpy((UInt8 *)mbuf_data(pkt) + hdrSize, mbuf_data(rxBufArray[index].mbuf), len);
+        mbuf_setlen(pkt, hdrSize + len);
+        pktSize += len;
+        rxCopyPackets++;
+        goto finish;
+    }
+    mbuf_setlen(pkt, hdrSize);
+    tail = pkt;
+    page = &rxPsPageArray[index * (PS_PAGE_BUFFERS - 1)];
+
+    /* Chain the pages behind the header. */
+    for (i = 0; i < rxPsPages; i++) {
+        len = OSSwapLittleToHostInt16(desc->wb.upper.length[i]);
+
+        if (!len)
+            break;
+
+        m = intelReplaceRxBuffer((i) ? &page[i - 1] : &rxBufArray[index], len, &addr);
+
+        if (!m) {
+            freePacket(pkt);
+            pkt = NULL;
+            goto nomem;
+        }
+        mbuf_setlen(m, len);
+        mbuf_setflags_mask(m, 0, MBUF_PKTHDR);
+        mbuf_setnext(tail, m);
+
+        tail = m;
+        pktSize += len;
+    }
+    rxSplitPackets++;
+
+finish:
+    mbuf_pkthdr_setlen(pkt, pktSize);
+
+done:
+    return pkt;
+
+nomem:
+    etherStats->dot3RxExtraEntry.resourceErrors++;
+    goto done;
+}
+
+/*
+ * Receive loop of packet split mode, see rxInterrupt(). Each descriptor
+ * holds a complete packet. The bytes received are added to *rxBytes.
+ */
+#ifdef __PRIVATE_SPI__
+UInt32 IntelMausi::intelRxPsInterrupt(IONetworkInterface *interface, uint32_t maxCount, IOMbufQueue *pollQueue, UInt32 *rxBytes)
+#else
+UInt32 IntelMausi::intelRxPsInterrupt(UInt32 maxCount, UInt32 *rxBytes)
+#endif /* __PRIVATE_SPI__ */
+{
+    union e1000_rx_desc_packet_split *desc = &rxPsDescArray[rxNextDescIndex];
+    mbuf_t pkt;
+    UInt32 status;
+    UInt32 goodPkts = 0;
+#ifndef __PRIVATE_SPI__
+    UInt32 crcSize = (adapterData.flags2 & FLAG2_CRC_STRIPPING) ? 0 : kIOEthernetCRCSize;
+#endif /* __PRIVATE_SPI__ */
+    UInt16 vlanTag;
+
+    while (((status = OSSwapLittleToHostInt32(desc->wb.middle.status_error)) & E1000_RXD_STAT_DD) && (goodPkts < maxCount)) {
+        pkt = intelRxPsPacket(rxNextDescIndex, desc, status);
+
+        if (pkt) {
+            vlanTag = (status & E1000_RXD_STAT_VP) ? (OSSwapLittleToHostInt16(desc->wb.middle.vlan) & E1000_RXD_SPC_VLAN_MASK) : 0;
+
+            *rxBytes += (UInt32)mbuf_pkthdr_len(pkt);
+            intelGetChecksumResult(pkt, status);
+            intelSetRxFlowId(pkt, OSSwapLittleToHostInt32(desc->wb.lower.mrq) & E1000_RXDEXT_RSSTYPE_MASK, OSSwapLittleToHostInt32(desc->wb.lower.hi_dword.rss));
+
+            /* Also get the VLAN tag if there is any. */
+            if (vlanTag)
+                setVlanTag(pkt, vlanTag);
+
+#ifdef __PRIVATE_SPI__
+            interface->enqueueInputPacket(pkt, pollQueue);
+#else
+            if (crcSize)
+                mbuf_adj(pkt, -(int)crcSize);
+
+            netif->inputPacket(pkt, 0, IONetworkInterface::kInputOptionQueuePacket);
+#endif /* __PRIVATE_SPI__ */
+
+            goodPkts++;
+        }
+        /* Finally update the descriptor and get the next one to examine. */
+        intelRxPsDescInit(rxNextDescIndex);
+
+        ++rxNextDescIndex &= rxDescMask;
+        desc = &rxPsDescArray[rxNextDescIndex];
+        rxCleanedCount++;
+    }
+    return goodPkts;
+}
+
+#ifdef __PRIVATE_SPI__
+
+UInt32 IntelMausi::rxInterrupt(IONetworkInterface *interface, uint32_t maxCount, IOMbufQueue *pollQueue, void *context)
+{
+    struct intelRxBatchEntry batch[kRxBatchSize];
     union e1000_rx_desc_extended *desc;
-    mbuf_t bufPkt, newPkt;
+    mbuf_t newPkt;
     UInt64 addr;
     UInt32 status;
     UInt32 goodPkts = 0;
+    UInt32 rxBytes = 0;
+    UInt32 numDescs;
     UInt32 pktSize;
-    UInt32 n;
+    UInt32 i;
     UInt16 vlanTag;
-    bool replaced;
 
     if (rxDescArray == NULL)
         return 0;
 
-    desc = &rxDescArray[rxNextDescIndex];
+    /* Packet split has a receive loop of its own. */
+    if (rxPsPages) {
+        goodPkts = intelRxPsInterrupt(interface, maxCount, pollQueue, &rxBytes);
+        goto updateTail;
+    }
+    /*
+     * Phase one harvests a batch of completed descriptors, phase two
+     * hands over the packets and replaces the buffers.
+     */
+    while ((goodPkts < maxCount) && (numDescs = intelRxHarvest(batch, maxCount - goodPkts))) {
+        for (i = 0; i < numDescs; i++) {
+            desc = &rxDescArray[rxNextDescIndex];
+            addr = rxBufArray[rxNextDescIndex].phyAddr;
+            status = batch[i].status;
+            pktSize = batch[i].length;
+            vlanTag = (status & E1000_RXD_STAT_VP) ? (batch[i].vlan & E1000_RXD_SPC_VLAN_MASK) : 0;
 
-    while (((status = OSSwapLittleToHostInt32(desc->wb.upper.status_error)) & E1000_RXD_STAT_DD) && (goodPkts < maxCount)) {
-        addr = rxBufArray[rxNextDescIndex].phyAddr;
-        bufPkt = rxBufArray[rxNextDescIndex].mbuf;
-        pktSize = OSSwapLittleToHostInt16(desc->wb.upper.length);
-        vlanTag = (status & E1000_RXD_STAT_VP) ? (OSSwapLittleToHostInt16(desc->wb.upper.vlan) & E1000_RXD_SPC_VLAN_MASK) : 0;
+            /* Drop the remaining buffers of a discarded jumbo frame. */
+            if (rxDiscard) {
+                if (status & E1000_RXD_STAT_EOP)
+                    rxDiscard = false;
 
-        /* Skip bad packet. */
-        if (status & E1000_RXDEXT_ERR_FRAME_ERR_MASK) {
-            DebugLog("[IntelMausi]: Bad packet.\n");
-            etherStats->dot3StatsEntry.internalMacReceiveErrors++;
-            discardPacketFragment(true);
-            goto nextDesc;
-        }
-        newPkt = replaceOrCopyPacket(&bufPkt, pktSize, &replaced);
-
-        if (!newPkt) {
-            /* Allocation of a new packet failed so that we must leave the original packet in place. */
-            //DebugLog("[IntelMausi]: replaceOrCopyPacket() failed.\n");
-            etherStats->dot3RxExtraEntry.resourceErrors++;
-            discardPacketFragment(true);
-            goto nextDesc;
-        }
+                goto nextDesc;
+            }
+            /* Skip bad packet. */
+            if (status & E1000_RXDEXT_ERR_FRAME_ERR_MASK) {
+                DebugLog("[IntelMausi]: Bad packet.\n");
+                etherStats->dot3StatsEntry.internalMacReceiveErrors++;
+                discardPacketFragment(true);
+                rxDiscard = !(status & E1000_RXD_STAT_EOP);
+                goto nextDesc;
+            }
+            newPkt = NULL;
+
+            /* Small packets are copied and the buffer is left on the ring. */
+            if ((pktSize <= rxCopyBreak) && (status & E1000_RXD_STAT_EOP) && !rxPacketHead)
+                newPkt = intelCopyRxPacket(rxNextDescIndex, pktSize);
 
-        /* If the packet was replaced we have to update the descriptor's buffer address. */
-        if (replaced) {
-            n = rxMbufCursor->getPhysicalSegments(bufPkt, &rxSegment, 1);
+            if (!newPkt)
+                newPkt = intelReplaceRxBuffer(&rxBufArray[rxNextDescIndex], pktSize, &addr);
 
-            if ((n != 1) || (rxSegment.location & 0x07ff)) {
-                DebugLog("[IntelMausi]: getPhysicalSegments() failed.\n");
+            if (!newPkt) {
                 etherStats->dot3RxExtraEntry.resourceErrors++;
-                freePacketEx(bufPkt);
                 discardPacketFragment(true);
+                rxDiscard = !(status & E1000_RXD_STAT_EOP);
                 goto nextDesc;
             }
-            addr = rxSegment.location;
-            rxBufArray[rxNextDescIndex].mbuf = bufPkt;
-            rxBufArray[rxNextDescIndex].phyAddr = addr;
-        }
-        /* Set the length of the buffer. */
-        mbuf_setlen(newPkt, pktSize);
+            /* Set the length of the buffer. */
+            mbuf_setlen(newPkt, pktSize);
 
-        if (status & E1000_RXD_STAT_EOP) {
-            if (rxPacketHead) {
-                /* This is the last buffer of a jumbo frame. */
-                mbuf_setflags_mask(newPkt, 0, MBUF_PKTHDR);
-                mbuf_setnext(rxPacketTail, newPkt);
-
-                rxPacketSize += pktSize;
-                rxPacketTail = newPkt;
-            } else {
-                /*
-                 * We've got a complete packet in one buffer.
-                 * It can be enqueued directly.
-                 */
-                rxPacketHead = newPkt;
-                rxPacketSize = pktSize;
-            }
-            intelGetChecksumResult(rxPacketHead, status);
+            if (status & E1000_RXD_STAT_EOP) {
+                if (rxPacketHead) {
+                    /* This is the last buffer of a jumbo frame. */
+                    mbuf_setflags_mask(newPkt, 0, MBUF_PKTHDR);
+                    mbuf_setnext(rxPacketTail, newPkt);
 
-            /* Also get the VLAN tag if there is any. */
-            if (vlanTag)
-                setVlanTag(rxPacketHead, vlanTag);
+                    rxPacketSize += pktSize;
+                    rxPacketTail = newPkt;
+                } else {
+                    /*
+                     * We've got a complete packet in one buffer.
+                     * It can be enqueued directly.
+                     */
+                    rxPacketHead = newPkt;
+                    rxPacketSize = pktSize;
+                }
+                rxBytes += rxPacketSize;
+                intelGetChecksumResult(rxPacketHead, status);
+                intelSetRxFlowId(rxPacketHead, batch[i].rssType, batch[i].rssHash);
 
-            mbuf_pkthdr_setlen(rxPacketHead, rxPacketSize);
-            interface->enqueueInputPacket(rxPacketHead, pollQueue);
+                /* Also get the VLAN tag if there is any. */
+                if (vlanTag)
+                    setVlanTag(rxPacketHead, vlanTag);
 
-            rxPacketHead = rxPacketTail = NULL;
-            rxPacketSize = 0;
+                mbuf_pkthdr_setlen(rxPacketHead, rxPacketSize);
+                interface->enqueueInputPacket(rxPacketHead, pollQueue);
 
-            goodPkts++;
-        } else {
-            if (rxPacketHead) {
-                /* We are in the middle of a jumbo frame. */
-                mbuf_setflags_mask(newPkt, 0, MBUF_PKTHDR);
-                mbuf_setnext(rxPacketTail, newPkt);
+                rxPacketHead = rxPacketTail = NULL;
+                rxPacketSize = 0;
 
-                rxPacketTail = newPkt;
-                rxPacketSize += pktSize;
+                goodPkts++;
             } else {
-                /* This is the first buffer of a jumbo frame. */
-                rxPacketHead = rxPacketTail = newPkt;
-                rxPacketSize = pktSize;
+                if (rxPacketHead) {
+                    /* We are in the middle of a jumbo frame. */
+                    mbuf_setflags_mask(newPkt, 0, MBUF_PKTHDR);
+                    mbuf_setnext(rxPacketTail, newPkt);
+
+                    rxPacketTail = newPkt;
+                    rxPacketSize += pktSize;
+                } else {
+                    /* This is the first buffer of a jumbo frame. */
+                    rxPacketHead = rxPacketTail = newPkt;
+                    rxPacketSize = pktSize;
+                }
             }
-        }
 
-        /* Finally update the descriptor and get the next one to examine. */
-    nextDesc:
-        desc->read.buffer_addr = OSSwapHostToLittleInt64(addr);
-        desc->read.reserved = 0;
+            /* Finally update the descriptor and get the next one to examine. */
+        nextDesc:
+            desc->read.buffer_addr = OSSwapHostToLittleInt64(addr);
+            desc->read.reserved = 0;
 
-        ++rxNextDescIndex &= kRxDescMask;
-        desc = &rxDescArray[rxNextDescIndex];
-        rxCleanedCount++;
+            ++rxNextDescIndex &= rxDescMask;
+            rxCleanedCount++;
+        }
     }
-    if (rxCleanedCount >= E1000_RX_BUFFER_WRITE) {
-        /*
-         * Prevent the tail from reaching the head in order to avoid a false
-         * buffer queue full condition.
-         */
-        if (adapterData.flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
-            intelUpdateRxDescTail((rxNextDescIndex - 1) & kRxDescMask);
-        else
-            intelWriteMem32(E1000_RDT(0), (rxNextDescIndex - 1) & kRxDescMask);
 
-        rxCleanedCount = 0;
+updateTail:
+    if (intelItrActive()) {
+        adapterData.total_rx_packets += goodPkts;
+        adapterData.total_rx_bytes += rxBytes;
     }
+    intelHistogramAdd(&rxPassHist, goodPkts);
+    intelRxUpdateTail(goodPkts >= maxCount);
+    intelRxPoolRefill();
+    intelRxCopyRefill();
+
     return goodPkts;
 }
 
 #else
 
-void IntelMausi::rxInterrupt()
+UInt32 IntelMausi::rxInterrupt(UInt32 maxCount)
 {
-    IOPhysicalSegment rxSegment;
-    union e1000_rx_desc_extended *desc = &rxDescArray[rxNextDescIndex];
-    mbuf_t bufPkt, newPkt;
+    struct intelRxBatchEntry batch[kRxBatchSize];
+    union e1000_rx_desc_extended *desc;
+    mbuf_t newPkt;
     UInt64 addr;
     UInt32 status;
     UInt32 goodPkts = 0;
+    UInt32 rxBytes = 0;
     UInt32 crcSize = (adapterData.flags2 & FLAG2_CRC_STRIPPING) ? 0 : kIOEthernetCRCSize;
+    UInt32 numDescs;
     UInt32 pktSize;
+    UInt32 i;
     UInt16 vlanTag;
-    bool replaced;
 
-    while ((status = OSSwapLittleToHostInt32(desc->wb.upper.status_error)) & E1000_RXD_STAT_DD) {
-        addr = rxBufArray[rxNextDescIndex].phyAddr;
-        bufPkt = rxBufArray[rxNextDescIndex].mbuf;
+    /* Packet split has a receive loop of its own. */
+    if (rxPsPages) {
+        goodPkts = intelRxPsInterrupt(maxCount, &rxBytes);
+        goto updateTail;
+    }
 
-        /* As we don't support jumbo frames we consider fragmented packets as errors. */
-        if (!(status & E1000_RXD_STAT_EOP)) {
-            DebugLog("[IntelMausi]: Fragmented packet.\n");
-            etherStats->dot3StatsEntry.frameTooLongs++;
-            goto nextDesc;
-        }
-        pktSize = OSSwapLittleToHostInt16(desc->wb.upper.length) - crcSize;
-        vlanTag = (status & E1000_RXD_STAT_VP) ? (OSSwapLittleToHostInt16(desc->wb.upper.vlan) & E1000_RXD_SPC_VLAN_MASK) : 0;
-
-        /* Skip bad packet. */
-        if (status & E1000_RXDEXT_ERR_FRAME_ERR_MASK) {
-            DebugLog("[IntelMausi]: Bad packet.\n");
-            etherStats->dot3StatsEntry.internalMacReceiveErrors++;
-            goto nextDesc;
-        }
-        newPkt = replaceOrCopyPacket(&bufPkt, pktSize, &replaced);
+    /*
+     * Phase one harvests a batch of completed descriptors, phase two
+     * hands over the packets and replaces the buffers.
+     */
+    while ((goodPkts < maxCount) && (numDescs = intelRxHarvest(batch, maxCount - goodPkts))) {
+        for (i = 0; i < numDescs; i++) {
+            desc = &rxDescArray[rxNextDescIndex];
+            addr = rxBufArray[rxNextDescIndex].phyAddr;
+            status = batch[i].status;
+            pktSize = batch[i].length;
+            vlanTag = (status & E1000_RXD_STAT_VP) ? (batch[i].vlan & E1000_RXD_SPC_VLAN_MASK) : 0;
 
-        if (!newPkt) {
-            /* Allocation of a new packet failed so that we must leave the original packet in place. */
-            //DebugLog("[IntelMausi]: replaceOrCopyPacket() failed.\n");
-            etherStats->dot3RxExtraEntry.resourceErrors++;
-            goto nextDesc;
-        }
+            /* The CRC of a jumbo frame is trimmed once the frame is complete. */
+            if ((status & E1000_RXD_STAT_EOP) && !rxPacketHead)
+                pktSize -= crcSize;
+
+            /* Drop the remaining buffers of a discarded jumbo frame. */
+            if (rxDiscard) {
+                if (status & E1000_RXD_STAT_EOP)
+                    rxDiscard = false;
+
+                goto nextDesc;
+            }
+            /* Skip bad packet. */
+            if (status & E1000_RXDEXT_ERR_FRAME_ERR_MASK) {
+                DebugLog("[IntelMausi]: Bad packet.\n");
+                etherStats->dot3StatsEntry.internalMacReceiveErrors++;
+                discardPacketFragment();
+                rxDiscard = !(status & E1000_RXD_STAT_EOP);
+                goto nextDesc;
+            }
+            newPkt = NULL;
+
+            /* Small packets are copied and the buffer is left on the ring. */
+            if ((pktSize <= rxCopyBreak) && (status & E1000_RXD_STAT_EOP) && !rxPacketHead)
+                newPkt = intelCopyRxPacket(rxNextDescIndex, pktSize);
 
-        /* If the packet was replaced we have to update the descriptor's buffer address. */
-        if (replaced) {
-            if (rxMbufCursor->getPhysicalSegments(bufPkt, &rxSegment, 1) != 1) {
-                DebugLog("[IntelMausi]: getPhysicalSegments() failed.\n");
+            if (!newPkt)
+                newPkt = intelReplaceRxBuffer(&rxBufArray[rxNextDescIndex], pktSize, &addr);
+
+            if (!newPkt) {
                 etherStats->dot3RxExtraEntry.resourceErrors++;
-                freePacket(bufPkt);
+                discardPacketFragment();
+                rxDiscard = !(status & E1000_RXD_STAT_EOP);
                 goto nextDesc;
             }
-            addr = rxSegment.location;
-            rxBufArray[rxNextDescIndex].mbuf = bufPkt;
-            rxBufArray[rxNextDescIndex].phyAddr = addr;
-        }
-        intelGetChecksumResult(newPkt, status);
+            /* Set the length of the buffer. */
+            mbuf_setlen(newPkt, pktSize);
 
-        /* Also get the VLAN tag if there is any. */
-        if (vlanTag)
-            setVlanTag(newPkt, vlanTag);
+            if (status & E1000_RXD_STAT_EOP) {
+                if (rxPacketHead) {
+                    /* This is the last buffer of a jumbo frame. */
+                    mbuf_setflags_mask(newPkt, 0, MBUF_PKTHDR);
+                    mbuf_setnext(rxPacketTail, newPkt);
 
-        netif->inputPacket(newPkt, pktSize, IONetworkInterface::kInputOptionQueuePacket);
-        goodPkts++;
+                    rxPacketSize += pktSize;
+                    mbuf_pkthdr_setlen(rxPacketHead, rxPacketSize);
 
-        /* Finally update the descriptor and get the next one to examine. */
-    nextDesc:
-        desc->read.buffer_addr = OSSwapHostToLittleInt64(addr);
-        desc->read.reserved = 0;
+                    /* The CRC may span the last two buffers. */
+                    if (crcSize)
+                        mbuf_adj(rxPacketHead, -(int)crcSize);
+                } else {
+                    /* We've got a complete packet in one buffer. */
+                    rxPacketHead = newPkt;
+                    rxPacketSize = pktSize;
+                    mbuf_pkthdr_setlen(rxPacketHead, rxPacketSize);
+                }
+                rxBytes += rxPacketSize;
+                intelGetChecksumResult(rxPacketHead, status);
+                intelSetRxFlowId(rxPacketHead, batch[i].rssType, batch[i].rssHash);
 
-        ++rxNextDescIndex &= kRxDescMask;
-        desc = &rxDescArray[rxNextDescIndex];
-        rxCleanedCount++;
+                /* Also get the VLAN tag if there is any. */
+                if (vlanTag)
+                    setVlanTag(rxPacketHead, vlanTag);
+
+                netif->inputPacket(rxPacketHead, 0, IONetworkInterface::kInputOptionQueuePacket);
+
+                rxPacketHead = rxPacketTail = NULL;
+                rxPacketSize = 0;
+
+                goodPkts++;
+            } else {
+                if (rxPacketHead) {
+                    /* We are in the middle of a jumbo frame. */
+                    mbuf_setflags_mask(newPkt, 0, MBUF_PKTHDR);
+                    mbuf_setnext(rxPacketTail, newPkt);
+
+                    rxPacketTail = newPkt;
+                    rxPacketSize += pktSize;
+                } else {
+                    /* This is the first buffer of a jumbo frame. */
+                    rxPacketHead = rxPacketTail = newPkt;
+                    rxPacketSize = pktSize;
+                }
+            }
+
+            /* Finally update the descriptor and get the next one to examine. */
+        nextDesc:
+            desc->read.buffer_addr = OSSwapHostToLittleInt64(addr);
+            desc->read.reserved = 0;
+
+            ++rxNextDescIndex &= rxDescMask;
+            rxCleanedCount++;
+        }
+    }
+
+updateTail:
+    if (intelItrActive()) {
+        adapterData.total_rx_packets += goodPkts;
+        adapterData.total_rx_bytes += rxBytes;
     }
+    intelHistogramAdd(&rxPassHist, goodPkts);
+
     if (goodPkts)
         netif->flushInputQueue();
 
-    if (rxCleanedCount >= E1000_RX_BUFFER_WRITE) {
-        /*
-         * Prevent the tail from reaching the head in order to avoid a false
-         * buffer queue full condition.
-         */
-        if (adapterData.flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
-            intelUpdateRxDescTail((rxNextDescIndex - 1) & kRxDescMask);
-        else
-            intelWriteMem32(E1000_RDT(0), (rxNextDescIndex - 1) & kRxDescMask);
+    intelRxUpdateTail(goodPkts >= maxCount);
+    intelRxPoolRefill();
+    intelRxCopyRefill();
 
-        rxCleanedCount = 0;
+    return goodPkts;
+}
+
+/*
+ * Poll pass of the rx ring while its interrupts are masked. Each pass
+ * processes at most rxPollBudget packets so that a flood of incoming
+ * packets can't monopolize the workloop. Polling continues as long as
+ * the budget is used up, after that the rx interrupts are rearmed.
+ */
+void IntelMausi::rxPollTimeout(IOTimerEventSource *timer)
+{
+    if (!isEnabled || !rxPolling)
+        return;
+
+    rxPollPasses++;
+
+    if (rxInterrupt(rxPollBudget) >= rxPollBudget) {
+        rxPollSource->setTimeoutUS(kRxPollDelayUS);
+    } else {
+        rxPolling = false;
+        intelWriteMem32(E1000_IMS, kRxIntrMask);
     }
-    etherStats->dot3RxExtraEntry.interrupts++;
 }
 
 #endif /* __PRIVATE_SPI__ */
@@ -1992,19 +2730,36 @@ void IntelMausi::checkLinkStatus()
 void IntelMausi::interruptOccurred(OSObject *client, IOInterruptEventSource *src, int count)
 {
     struct e1000_hw *hw = &adapterData.hw;
+    UInt64 start = mach_absolute_time();
+    UInt64 duration;
     UInt32 icr = intelReadMem32(E1000_ICR); /* read ICR disables interrupts using IAM */
 
+    if (icr & (E1000_ICR_RXQ0 | E1000_ICR_RXT0 | E1000_ICR_RXDMT0))
+        intrCauses[kIntrCauseRx]++;
+
+    if (icr & (E1000_ICR_TXDW | E1000_ICR_TXQ0))
+        intrCauses[kIntrCauseTx]++;
+
+    if (icr & (E1000_ICR_LSC | E1000_IMS_RXSEQ))
+        intrCauses[kIntrCauseLink]++;
+
+    if (icr & E1000_ICR_ECCER)
+        intrCauses[kIntrCauseECC]++;
+
+    if (!(icr & ~E1000_ICR_INT_ASSERTED))
+        intrCauses[kIntrCauseNone]++;
+
 #ifdef __PRIVATE_SPI__
     UInt32 packets;
 
     if (!polling) {
         if (icr & (E1000_ICR_TXDW | E1000_ICR_TXQ0)) {
-            txInterrupt();
+            intelTxReclaim();
             etherStats->dot3TxExtraEntry.interrupts++;
         }
 
         if (icr & (E1000_ICR_RXQ0 | E1000_ICR_RXT0 | E1000_ICR_RXDMT0)) {
-            packets = rxInterrupt(netif, kNumRxDesc, NULL, NULL);
+            packets = rxInterrupt(netif, numRxDesc, NULL, NULL);
             etherStats->dot3RxExtraEntry.interrupts++;
 
             if (packets)
@@ -2014,14 +2769,30 @@ void IntelMausi::interruptOccurred(OSObject *client, IOInterruptEventSource *src
 #else
     /* Handle transmit descriptors. */
     if (icr & (E1000_ICR_TXDW | E1000_ICR_TXQ0)) {
-        txInterrupt();
+        intelTxReclaim();
+        etherStats->dot3TxExtraEntry.interrupts++;
     }
-    /* Handle receive descriptors. */
-    if (icr & (E1000_ICR_RXQ0 | E1000_ICR_RXT0 | E1000_ICR_RXDMT0)) {
-        rxInterrupt();
+    /*
+     * Handle receive descriptors. With a poll budget a busy ring leaves
+     * the rx interrupts masked and is drained by rxPollTimeout().
+     */
+    if ((icr & (E1000_ICR_RXQ0 | E1000_ICR_RXT0 | E1000_ICR_RXDMT0)) && !rxPolling) {
+        if (rxPollBudget) {
+            if (rxInterrupt(rxPollBudget) >= rxPollBudget) {
+                rxPolling = true;
+                rxPollSource->setTimeoutUS(kRxPollDelayUS);
+            }
+        } else {
+            rxInterrupt(numRxDesc);
+        }
+        etherStats->dot3RxExtraEntry.interrupts++;
     }
 #endif /* __PRIVATE_SPI__ */
 
+    /* Retune the interrupt throttle to the traffic seen since the last completion. */
+    if (intelItrActive() && (icr & (E1000_ICR_RXQ0 | E1000_ICR_RXT0 | E1000_ICR_RXDMT0 | E1000_ICR_TXDW | E1000_ICR_TXQ0)))
+        intelSetItr(&adapterData);
+
     /* Reset on uncorrectable ECC error */
     if ((icr & E1000_ICR_ECCER) && (hw->mac.type >= e1000_pch_lpt)) {
         UInt32 pbeccsts = intelReadMem32(E1000_PBECCSTS);
@@ -2031,13 +2802,36 @@ void IntelMausi::interruptOccurred(OSObject *client, IOInterruptEventSource *src
 
         IOLog("[IntelMausi]: Uncorrectable ECC error. Reseting chip.\n");
         intelRestart();
-        return;
+        goto done;
     }
     if (icr & (E1000_ICR_LSC | E1000_IMS_RXSEQ)) {
         checkLinkStatus();
     }
-    /* Reenable interrupts by setting the bits in the mask register. */
-    intelWriteMem32(E1000_IMS, icr);
+    /* Keep the rx interrupts masked while the ring is polled. */
+    if (rxPolling)
+        icr &= ~kRxIntrMask;
+
+    /*
+     * Same for the tx interrupt while the transmit path reclaims descriptors.
+     * As the transmit path changes the mask under txReclaimLock, the flag
+     * has to be checked and IMS written holding the lock too.
+     */
+    if (enableTxInlineReclaim) {
+        IOLockLock(txReclaimLock);
+
+        if (txIntrMasked)
+            icr &= ~E1000_ICR_TXDW;
+
+        intelWriteMem32(E1000_IMS, icr);
+        IOLockUnlock(txReclaimLock);
+    } else {
+        /* Reenable interrupts by setting the bits in the mask register. */
+        intelWriteMem32(E1000_IMS, icr);
+    }
+
+done:
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &duration);
+    intelHistogramAdd(&intrDurationHist, (UInt32)(duration / 1000));
 }
 
 #pragma mark --- rx poll methods ---
@@ -2072,7 +2866,7 @@ void IntelMausi::pollInputPackets(IONetworkInterface *interface, uint32_t maxCou
         rxInterrupt(interface, maxCount, pollQueue, context);
 
         /* Finally cleanup the transmitter ring. */
-        txInterrupt();
+        intelTxReclaim();
     }
 
     //DebugLog("[IntelMausi]: pollInputPackets() <===\n");
@@ -2153,6 +2947,14 @@ void IntelMausi::setLinkUp()
         adapterData.rx_abs_int_delay = rxAbsTime1000;
         rate = intrThrValue1000;
 
+        /* Start adaptive moderation from the low latency class with fresh counters. */
+        if (enableAdaptiveITR) {
+            adapterData.total_tx_bytes = adapterData.total_tx_packets = 0;
+            adapterData.total_rx_bytes = adapterData.total_rx_packets = 0;
+            itrRate = 20000;
+            rxItrClass = txItrClass = low_latency;
+            rate = 1000000000 / (itrRate * 256);
+        }
         eeeMode = intelSupportsEEE(&adapterData);
 
         if (fcIndex == kFlowControlTypeNone) {
@@ -2225,6 +3027,18 @@ void IntelMausi::setLinkUp()
     /* Update interrupt throttle value. */
     intelWriteMem32(E1000_ITR, rate);
 
+    /* The tx delays may have been changed while the link was down. */
+    intelWriteMem32(E1000_TIDV, adapterData.tx_int_delay);
+    intelWriteMem32(E1000_TADV, adapterData.tx_abs_int_delay);
+
+    publishCoalescing();
+
+    /* Disable TSO at 10/100 speeds to avoid hardware issues. */
+    txTsoActive = (adapterData.link_speed == SPEED_1000) || (adapterData.flags & FLAG_TSO_FORCE);
+
+    if (enableTSO4 || enableTSO6)
+        intelUpdateTSOOffload();
+
     /* Enable transmits in the hardware. */
     tctl = intelReadMem32(E1000_TCTL);
     tctl |= E1000_TCTL_EN;
@@ -2264,6 +3078,13 @@ void IntelMausi::setLinkUp()
         pollParams.highThresholdBytes = 0x10000;
         pollParams.pollIntervalTime = (adapterData.link_speed == SPEED_1000) ? 170000 : 1000000;  /* 170µs / 1ms */
     }
+    /* These are the starting point of the adaptive controller. */
+    pollBaseParams = pollParams;
+    clock_get_uptime(&pollLastTime);
+    pollLastPackets = adapterData.stats.gprc;
+    pollLastBytes = adapterData.stats.gorc;
+    pollPktRate = 0;
+    pollByteRate = 0;
 
 #if __MAC_OS_X_VERSION_MIN_REQUIRED >= __MAC_10_9
     netif->setPacketPollingParameters(&pollParams, 0);
@@ -2368,6 +3189,273 @@ inline void IntelMausi::intelGetChecksumResult(mbuf_t m, UInt32 status)
     }
 }
 
+/*
+ * Attach the RSS hash computed by the NIC to a packet as its flow id so
+ * that upper layers don't have to hash it again. Packets of types which
+ * aren't hashed are left alone. The flow id is only 16 bits wide and the
+ * KPI is private, so that the legacy build just keeps the statistics.
+ */
+inline void IntelMausi::intelSetRxFlowId(mbuf_t m, UInt32 rssType, UInt32 rssHash)
+{
+    if (rssType) {
+        intelFlowTableAdd(&rxTopFlows, rssHash);
+
+#ifdef __PRIVATE_SPI__
+        mbuf_set_flowid(m, (UInt16)(rssHash ^ (rssHash >> 16)));
+#endif /* __PRIVATE_SPI__ */
+    }
+}
+
+/*
+ * Prepare the command bits and the context of a packet for transmission.
+ * This is shared by all transmit paths. Returns false in case the packet
+ * had to be dropped, in which case it has already been freed.
+ */
+bool IntelMausi::intelSetupTxDesc(mbuf_t *m, struct intelTxDescSetup *setup)
+{
+    UInt32 offloadFlags = 0;
+    UInt32 offloadClass;
+    UInt32 l3Offset;
+    UInt32 tsoFlags = 0;
+    UInt32 mss = 0;
+    UInt32 status;
+    UInt16 vlanTag;
+    bool result = true;
+
+    setup->cmd = 0;
+    setup->opts = (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS);
+    setup->word2 = 0;
+    setup->mss = 0;
+    setup->numDescs = 0;
+    setup->tso = false;
+
+    mbuf_get_tso_requested(*m, &tsoFlags, &mss);
+
+    if (tsoFlags & (MBUF_TSO_IPV4 | MBUF_TSO_IPV6)) {
+        /* TSO may have been disabled for the current link speed. */
+        status = txTsoActive ? intelTxSetupTSO(m, tsoFlags, mss, setup) : kTxSetupUnsupported;
+
+        if (status == kTxSetupDropped) {
+            DebugLog("[IntelMausi]: mbuf_pullup() failed. Dropping packet.\n");
+            result = false;
+            goto done;
+        }
+        if (status == kTxSetupUnsupported) {
+            /* Without segmentation the packet must fit into a single frame. */
+            if (mbuf_pkthdr_len(*m) > (adapterData.max_frame_size - ETH_FCS_LEN + kVlanHdrLen)) {
+                DebugLog("[IntelMausi]: TSO not possible. Dropping packet.\n");
+                freePacket(*m);
+                *m = NULL;
+                result = false;
+                goto done;
+            }
+            /* Fall back to checksum offload. */
+            offloadFlags = (tsoFlags & MBUF_TSO_IPV4) ? (kChecksumTCP | kChecksumIP) : kChecksumTCPIPv6;
+            mss = 0;
+            txTsoFallbacks++;
+        }
+    }
+    if (!setup->tso) {
+        if (!offloadFlags)
+            mbuf_get_csum_requested(*m, &offloadFlags, &mss);
+
+        offloadClass = intelTxOffloadClass(offloadFlags);
+
+        if (offloadClass != kTxOffloadNone) {
+            if (txSetupFuncs[offloadClass](*m, setup, &l3Offset) == kTxSetupDone) {
+                /* Omit the context descriptor in case the hardware still holds it. */
+                if (!intelTxContextLoaded(setup->ipConfig, setup->tcpConfig, setup->cmdLen, setup->mss))
+                    setup->numDescs = 1;
+            } else {
+                /* Headers the hardware can't handle get their checksums in software. */
+                mbuf_outbound_finalize(*m, (txOffloadInfo[offloadClass].etherType == ETH_P_IP) ? PF_INET : PF_INET6, l3Offset);
+                txSoftChecksums++;
+            }
+        }
+    }
+    /* Next get the VLAN tag and command bit. */
+    if (!mbuf_get_vlan_tag(*m, &vlanTag)) {
+        setup->opts |= E1000_TXD_CMD_VLE;
+        setup->word2 |= (vlanTag << E1000_TX_FLAGS_VLAN_SHIFT);
+    }
+    setup->pktLen = (UInt32)mbuf_pkthdr_len(*m);
+
+done:
+    return result;
+}
+
+/*
+ * Get the physical segments of a packet and split them at the tx fifo
+ * limit in case of TSO. Returns 0 on failure.
+ */
+UInt32 IntelMausi::intelMapTxSegments(mbuf_t m, struct intelTxDescSetup *setup, IOPhysicalSegment *segments)
+{
+    UInt32 numSegs;
+
+    numSegs = txMbufCursor->getPhysicalSegmentsWithCoalesce(m, segments, kMaxSegs);
+
+    if (numSegs && setup->tso)
+        numSegs = intelTxSplitSegments(segments, numSegs, kMaxSegs + kMaxSplitSegs, adapterData.tx_fifo_limit);
+
+    return numSegs;
+}
+
+inline bool IntelMausi::intelTxCopyable(mbuf_t m, struct intelTxDescSetup *setup)
+{
+    return (!setup->tso && (mbuf_pkthdr_len(m) <= txCopyBreak));
+}
+
+/*
+ * Fill in the context descriptor, if required, and the data descriptors
+ * of a packet. The mbuf is attached to the last descriptor. It may be NULL
+ * in case the packet has been copied into a bounce buffer.
+ */
+void IntelMausi::intelFillTxDescs(mbuf_t m, struct intelTxDescSetup *setup, IOPhysicalSegment *segments, UInt32 numSegs)
+{
+    struct e1000_data_desc *desc;
+    struct e1000_context_desc *contDesc;
+    UInt32 numDescs = setup->numDescs + numSegs;
+    UInt32 lastSeg = numSegs - 1;
+    UInt32 opts;
+    UInt32 index;
+    UInt32 i;
+    bool reportStatus;
+
+    OSAddAtomic(-numDescs, &txNumFreeDesc);
+    intelTxBqlQueued(setup->pktLen);
+    index = txNextDescIndex;
+    txNextDescIndex = (txNextDescIndex + numDescs) & txDescMask;
+
+    /* Request a status report only every couple of descriptors. */
+    txDescsSinceRS += numDescs;
+    reportStatus = (txDescsSinceRS >= intelTxRSThreshold());
+
+    /* Setup the context descriptor for TSO or checksum offload. */
+    if (setup->numDescs) {
+        contDesc = (struct e1000_context_desc *)&txDescArray[index];
+
+        txBufArray[index].mbuf = NULL;
+        txBufArray[index].numDescs = 0;
+
+#ifdef DEBUG
+        txBufArray[index].pad = numSegs;
+#endif
+
+        intelTxWriteContext(contDesc, setup);
+
+        txCtxIpConfig = setup->ipConfig;
+        txCtxTcpConfig = setup->tcpConfig;
+        txCtxCmdLen = setup->cmdLen;
+        txCtxMss = setup->mss;
+        txCtxValid = true;
+
+        ++index &= txDescMask;
+    }
+    /* And finally fill in the data descriptors. */
+    for (i = 0; i < numSegs; i++) {
+        desc = &txDescArray[index];
+
+        if (i == lastSeg) {
+            opts = setup->opts;
+            txBufArray[index].mbuf = m;
+            txBufArray[index].numDescs = numDescs;
+            txBufArray[index].numBytes = setup->pktLen;
+
+            if (reportStatus) {
+                opts |= E1000_TXD_CMD_RS;
+                intelTxQueueRS(index);
+            }
+            txLastWord1 = intelTxWriteData(desc, setup, &segments[i], opts);
+        } else {
+            txBufArray[index].mbuf = NULL;
+            txBufArray[index].numDescs = 0;
+            intelTxWriteData(desc, setup, &segments[i], 0);
+        }
+
+#ifdef DEBUG
+        txBufArray[index].pad = (UInt32)segments[i].length;
+#endif
+
+        ++index &= txDescMask;
+    }
+}
+
+/*
+ * Number of descriptors after which a status report is requested. It grows
+ * with the ring occupancy. At low load the status report requested when the
+ * tail is updated keeps completion latency low anyway.
+ */
+inline UInt32 IntelMausi::intelTxRSThreshold()
+{
+    UInt32 threshold = 0;
+
+    if (enableRSBatching) {
+        threshold = (numTxDesc - txNumFreeDesc) >> 2;
+
+        if (threshold < kTxRSMinBatch)
+            threshold = kTxRSMinBatch;
+        else if (threshold > kTxRSMaxBatch)
+            threshold = kTxRSMaxBatch;
+    }
+    return threshold;
+}
+
+void IntelMausi::intelTxQueueRS(UInt16 index)
+{
+    txRSQueue[txRSTail] = index;
+    ++txRSTail &= txDescMask;
+    txDescsSinceRS = 0;
+}
+
+/*
+ * The hardware keeps the last context until a new one is loaded, so the
+ * context descriptor can be omitted as long as the offload parameters of
+ * consecutive packets are identical.
+ */
+inline bool IntelMausi::intelTxContextLoaded(UInt32 ipConfig, UInt32 tcpConfig, UInt32 cmdLen, UInt32 mss)
+{
+    return (txCtxValid && (txCtxIpConfig == ipConfig) && (txCtxTcpConfig == tcpConfig) &&
+            (txCtxCmdLen == cmdLen) && (txCtxMss == mss));
+}
+
+/*
+ * Copy a small packet into the bounce buffer which belongs to the
+ * descriptor at index so that it can be freed immediately.
+ */
+inline void IntelMausi::intelCopyTxPacket(mbuf_t m, UInt32 index, IOPhysicalSegment *segment)
+{
+    UInt32 offset = index * kTxCopyBufSize;
+    UInt32 len = (UInt32)mbuf_pkthdr_len(m);
+
+    mbuf_copydata(m, 0, len, txCopyBuffer + offset);
+
+    segment->location = txCopyPhyAddr + offset;
+    segment->length = len;
+    txCopyPackets++;
+}
+
+/*
+ * Update the interface's TSO offload flags after a link change so that
+ * the stack stops sending TSO packets while TSO is disabled.
+ */
+void IntelMausi::intelUpdateTSOOffload()
+{
+    ifnet_t ifp = netif->getIfnet();
+    UInt32 offload = ifnet_offload(ifp);
+
+    offload &= ~(IFNET_TSO_IPV4 | IFNET_TSO_IPV6);
+
+    if (txTsoActive) {
+        if (enableTSO4)
+            offload |= IFNET_TSO_IPV4;
+
+        if (enableTSO6)
+            offload |= IFNET_TSO_IPV6;
+    }
+    if (ifnet_set_offload(ifp, (ifnet_offload_t)offload))
+        DebugLog("[IntelMausi]: Failed to update TSO offload flags.\n");
+}
+
 bool IntelMausi::intelIdentifyChip()
 {
     const struct e1000_info *ei;
@@ -2416,6 +3504,8 @@ bool IntelMausi::intelStart()
 
     /* Setup some default values. */
     adapterData.rx_buffer_len = kRxBufferPktSize;
+    adapterData.rx_ps_pages = 0;
+    adapterData.rx_ps_bsize0 = kRxPsHdrSize;
     adapterData.max_frame_size = mtu + ETH_HLEN + ETH_FCS_LEN;
     adapterData.min_frame_size = ETH_ZLEN + ETH_FCS_LEN;
 
@@ -2589,6 +3679,78 @@ error_eeprom:
 }
 #pragma mark --- timer action methods ---
 
+#ifdef __PRIVATE_SPI__
+
+/*
+ * Recompute the packet polling parameters from the receive rates seen
+ * since the last call and hand them over to the stack.
+ *
+ * - The packet thresholds are the per speed defaults of setLinkUp()
+ *   scaled by pollBias. A bias towards latency raises them so that the
+ *   interface stays in interrupt mode longer, a bias towards throughput
+ *   lowers them.
+ * - The byte thresholds are the packet thresholds times the average
+ *   packet size, so that both agree for the current traffic mix.
+ * - The poll interval is the time it takes to receive the high packet
+ *   threshold at the current packet rate, again scaled by pollBias.
+ *
+ * Rates are smoothed and the results rounded so that the parameters are
+ * only pushed when the traffic pattern really changes.
+ */
+void IntelMausi::intelUpdatePollParams()
+{
+    IONetworkPacketPollingParameters params;
+    UInt64 now, elapsed;
+    UInt64 packets, bytes;
+    UInt64 avgSize, interval;
+
+    clock_get_uptime(&now);
+    absolutetime_to_nanoseconds(now - pollLastTime, &elapsed);
+
+    packets = adapterData.stats.gprc - pollLastPackets;
+    bytes = adapterData.stats.gorc - pollLastBytes;
+
+    pollLastTime = now;
+    pollLastPackets = adapterData.stats.gprc;
+    pollLastBytes = adapterData.stats.gorc;
+
+    if (!elapsed)
+        return;
+
+    pollPktRate = (3 * pollPktRate + (packets * 1000000000ULL) / elapsed) >> 2;
+    pollByteRate = (3 * pollByteRate + (bytes * 1000000000ULL) / elapsed) >> 2;
+
+    params = pollBaseParams;
+
+    /* Keep the defaults as long as there is hardly any traffic. */
+    if (pollPktRate >= params.highThresholdPackets) {
+        params.lowThresholdPackets = max_t(UInt32, (params.lowThresholdPackets * (kPollBiasMax + kPollBiasDef - pollBias)) / kPollBiasMax, 1);
+        params.highThresholdPackets = max_t(UInt32, (params.highThresholdPackets * (kPollBiasMax + kPollBiasDef - pollBias)) / kPollBiasMax, params.lowThresholdPackets + 1);
+
+        avgSize = pollByteRate / pollPktRate;
+        avgSize = min_t(UInt64, max_t(UInt64, avgSize, ETH_ZLEN), adapterData.max_frame_size);
+        avgSize = (avgSize + 63) & ~63ULL;
+
+        params.lowThresholdBytes = params.lowThresholdPackets * avgSize;
+        params.highThresholdBytes = params.highThresholdPackets * avgSize;
+
+        interval = (params.highThresholdPackets * 1000000000ULL) / pollPktRate;
+        interval = (interval * (kPollBiasDef + pollBias)) / kPollBiasMax;
+        interval = min_t(UInt64, max_t(UInt64, interval, kPollIntervalMinNS), kPollIntervalMaxNS);
+        params.pollIntervalTime = interval - (interval % kPollIntervalStepNS);
+    }
+    if (memcmp(&params, &pollParams, sizeof(IONetworkPacketPollingParameters))) {
+        pollParams = params;
+
+#if __MAC_OS_X_VERSION_MIN_REQUIRED >= __MAC_10_9
+        netif->setPacketPollingParameters(&pollParams, 0);
+#endif
+        DebugLog("[IntelMausi]: poll thresholds %u/%u packets, %u/%u bytes, interval %lluus\n", pollParams.lowThresholdPackets, pollParams.highThresholdPackets, pollParams.lowThresholdBytes, pollParams.highThresholdBytes, (pollParams.pollIntervalTime / 1000));
+    }
+}
+
+#endif /* __PRIVATE_SPI__ */
+
 void IntelMausi::timerAction(IOTimerEventSource *timer)
 {
     struct e1000_hw *hw = &adapterData.hw;
@@ -2599,6 +3761,10 @@ void IntelMausi::timerAction(IOTimerEventSource *timer)
     }
     intelUpdateAdaptive(&adapterData.hw);
 
+    /* Packets may wait for reclaim as long as the tx interrupt is masked. */
+    if (txIntrMasked)
+        intelTxReclaim();
+
     /* Check for tx deadlock. */
     if (checkForDeadlock())
         goto done;
@@ -2612,7 +3778,15 @@ void IntelMausi::timerAction(IOTimerEventSource *timer)
 
         eeeMode = 0;
     }
+    intelRxPoolAdjust();
     updateStatistics(&adapterData);
+
+#ifdef __PRIVATE_SPI__
+    if (enableAdaptivePolling)
+        intelUpdatePollParams();
+#endif /* __PRIVATE_SPI__ */
+
+    publishStatistics();
     timerSource->setTimeoutMS(kTimeoutMS);
 
 done:
@@ -2701,6 +3875,187 @@ void IntelMausi::updateStatistics(struct e1000_adapter *adapter)
     etherStats->dot3RxExtraEntry.frameTooShorts = (UInt32)adapter->stats.ruc;
 }
 
+/* Export the driver's internal statistics to the registry. */
+void IntelMausi::publishStatistics()
+{
+    OSDictionary *dict = OSDictionary::withCapacity(4);
+
+    if (dict) {
+#ifdef __PRIVATE_SPI__
+        addHistogram(dict, kTxBurstHistName, &txBurstHist);
+#else
+        addNumber(dict, kTxDoorbellsSavedName, txDoorbellsSaved);
+#endif /* __PRIVATE_SPI__ */
+        addNumber(dict, kTxCopyPacketsName, txCopyPackets);
+        addNumber(dict, kTxSoftChecksumsName, txSoftChecksums);
+        addNumber(dict, kTxTsoFallbacksName, txTsoFallbacks);
+        addNumber(dict, kRxPoolHitsName, rxPoolHits);
+        addNumber(dict, kRxPoolMissesName, rxPoolMisses);
+        addNumber(dict, kRxPoolAllocFailsName, rxPoolAllocFails);
+        addNumber(dict, kRxPoolSizeName, rxPoolCount);
+        addNumber(dict, kRxCopyPacketsName, rxCopyPackets);
+        addNumber(dict, kRxCopyAllocFailsName, rxCopyAllocFails);
+        addNumber(dict, kRxReplacePacketsName, rxReplacePackets);
+        addNumber(dict, kRxSplitPacketsName, rxSplitPackets);
+        addHistogram(dict, kRxTailBatchHistName, &rxTailHist);
+        addNumber(dict, kRxTailUrgentName, rxTailUrgent);
+        addNumber(dict, kRxNoBuffersName, adapterData.stats.rnbc);
+        addNumber(dict, kRxMissedPacketsName, adapterData.stats.mpc);
+        addTopFlows(dict);
+        addNumber(dict, kIntrRateName, itrRate);
+#ifdef __PRIVATE_SPI__
+        addNumber(dict, kPollIntervalName, pollParams.pollIntervalTime / 1000);
+#else
+        addNumber(dict, kRxPollPassesName, rxPollPasses);
+#endif /* __PRIVATE_SPI__ */
+        addHistogram(dict, kTxReclaimHistName, &txReclaimHist);
+        addHistogram(dict, kIntrDurationHistName, &intrDurationHist);
+        addHistogram(dict, kRxPassHistName, &rxPassHist);
+        addHistogram(dict, kTxPassHistName, &txPassHist);
+        addIntrCauses(dict);
+        addNumber(dict, kTxByteLimitName, txBql.limit);
+        addNumber(dict, kTxInflightBytesName, (UInt32)(txBql.numQueued - txBql.numCompleted));
+
+        setProperty(kStatisticsName, dict);
+        dict->release();
+    }
+}
+
+/* Export the current coalescing parameters, the counterpart of ethtool's get_coalesce. */
+void IntelMausi::publishCoalescing()
+{
+    OSDictionary *dict = OSDictionary::withCapacity(5);
+    UInt32 *thrValue, *rxDelay, *rxAbs;
+    UInt32 usecs;
+
+    if (dict) {
+        intelGetSpeedCoalesce(&thrValue, &rxDelay, &rxAbs);
+
+        if (enableAdaptiveITR)
+            usecs = (itrConservative) ? 3 : 1;
+        else
+            usecs = (*thrValue * 256) / 1000;
+
+        addNumber(dict, kRxCoalesceUsecsName, usecs);
+        addNumber(dict, kRxDelayTimeName, *rxDelay);
+        addNumber(dict, kRxAbsTimeName, *rxAbs);
+        addNumber(dict, kTxDelayTimeName, adapterData.tx_int_delay);
+        addNumber(dict, kTxAbsTimeName, adapterData.tx_abs_int_delay);
+
+        setProperty(kCoalesceName, dict);
+        dict->release();
+    }
+}
+
+void IntelMausi::addIntrCauses(OSDictionary *dict)
+{
+    OSDictionary *causes = OSDictionary::withCapacity(kIntrCauseCount);
+
+    if (causes) {
+        addNumber(causes, "rx", intrCauses[kIntrCauseRx]);
+        addNumber(causes, "tx", intrCauses[kIntrCauseTx]);
+        addNumber(causes, "link", intrCauses[kIntrCauseLink]);
+        addNumber(causes, "ecc", intrCauses[kIntrCauseECC]);
+        addNumber(causes, "none", intrCauses[kIntrCauseNone]);
+
+        dict->setObject(kIntrCausesName, causes);
+        causes->release();
+    }
+}
+
+/* Publish the flow table as an array of hash and packet count pairs. */
+void IntelMausi::addTopFlows(OSDictionary *dict)
+{
+    OSArray *array = OSArray::withCapacity(kNumTopFlows);
+    OSDictionary *flow;
+    UInt32 i;
+
+    if (array) {
+        for (i = 0; i < kNumTopFlows; i++) {
+            if (!rxTopFlows.packets[i])
+                continue;
+
+            flow = OSDictionary::withCapacity(2);
+
+            if (flow) {
+                addNumber(flow, "hash", rxTopFlows.hash[i]);
+                addNumber(flow, "packets", rxTopFlows.packets[i]);
+                array->setObject(flow);
+                flow->release();
+            }
+        }
+        dict->setObject(kRxTopFlowsName, array);
+        array->release();
+    }
+}
+
+void IntelMausi::addHistogram(OSDictionary *dict, const char *name, struct IntelHistogram *hist)
+{
+    OSArray *array = OSArray::withCapacity(kNumHistBuckets);
+    OSNumber *num;
+    UInt32 i;
+
+    if (array) {
+        for (i = 0; i < kNumHistBuckets; i++) {
+            num = OSNumber::withNumber(hist->buckets[i], 32);
+
+            if (num) {
+                array->setObject(num);
+                num->release();
+            }
+        }
+        dict->setObject(name, array);
+        array->release();
+    }
+}
+
+void IntelMausi::addNumber(OSDictionary *dict, const char *name, UInt64 value)
+{
+    OSNumber *num = OSNumber::withNumber(value, 64);
+
+    if (num) {
+        dict->setObject(name, num);
+        num->release();
+    }
+}
+
+inline void IntelMausi::intelHistogramAdd(struct IntelHistogram *hist, UInt32 value)
+{
+    UInt32 i = (value > 1) ? (31 - __builtin_clz(value)) : 0;
+
+    if (i >= kNumHistBuckets)
+        i = kNumHistBuckets - 1;
+
+    hist->buckets[i]++;
+}
+
+/*
+ * Count a packet of the flow with the given hash. Packets of a flow tend to
+ * arrive in bursts so that the entry of the previous packet is tried first.
+ */
+inline void IntelMausi::intelFlowTableAdd(struct IntelFlowTable *table, UInt32 hash)
+{
+    UInt32 min = 0;
+    UInt32 i;
+
+    if (!((table->hash[table->last] == hash) && table->packets[table->last])) {
+        for (i = 0; i < kNumTopFlows; i++) {
+            if ((table->hash[i] == hash) && table->packets[i])
+                break;
+
+            if (table->packets[i] < table->packets[min])
+                min = i;
+        }
+        /* Replace the smallest entry by the new flow. */
+        if (i == kNumTopFlows) {
+            table->hash[min] = hash;
+            i = min;
+        }
+        table->last = i;
+    }
+    table->packets[table->last]++;
+}
+
 bool IntelMausi::checkForDeadlock()
 {
     bool deadlock = false;
@@ -2712,7 +4067,7 @@ bool IntelMausi::checkForDeadlock()
         eeeMode = 0;
     }
 
-    if ((txDescDoneCount == txDescDoneLast) && (txNumFreeDesc < kNumTxDesc)) {
+    if ((txDescDoneCount == txDescDoneLast) && (txNumFreeDesc < numTxDesc)) {
         if (++deadlockWarn >= kTxDeadlockTreshhold) {
             mbuf_t m = txBufArray[txDirtyIndex].mbuf;
             UInt32 pktSize;
@@ -2728,7 +4083,7 @@ bool IntelMausi::checkForDeadlock()
 
 #ifdef DEBUG
             for (i = 0; i < 30; i++) {
-                index = ((stalledIndex - 20 + i) & kTxDescMask);
+                index = ((stalledIndex - 20 + i) & txDescMask);
 
                 IOLog("[IntelMausi]: desc[%u]: lower=0x%08x, upper=0x%08x, addr=0x%016llx, mbuf=0x%016llx, len=%u.\n", index, txDescArray[index].lower.data, txDescArray[index].upper.data, txDescArray[index].buffer_addr, (UInt64)txBufArray[index].mbuf, txBufArray[index].pad);
             }
@@ -2769,7 +4124,7 @@ bool IntelMausi::checkForDeadlock()
             /* Flush pending tx descriptors. */
             intelFlushDescriptors();
             /* Check the transmitter ring. */
-            txInterrupt();
+            intelTxReclaim();
         }
     } else {
         deadlockWarn = 0;
@@ -23,6 +23,8 @@ extern "C" {
     #include <kdp/kdp_support.h>
 }
 
+#include "IntelMausiRing.h"
+
 #ifdef DEBUG
 #define DebugLog(args...) IOLog(args)
 #else
@@ -39,6 +41,13 @@ extern "C" {
 #define intelReadMem32(reg)             OSReadLittleInt32((baseAddr), (reg))
 #define intelFlush()                    OSReadLittleInt32((baseAddr), (E1000_STATUS))
 
+/*
+ * Descriptor updates must be visible to the NIC before a tail register is
+ * written. With cacheable rings the DMA is coherent and x86 doesn't reorder
+ * stores so that keeping the compiler from moving them is sufficient.
+ */
+#define intelDescBarrier()              do { OSSynchronizeIO(); __asm__ volatile("" ::: "memory"); } while (0)
+
 /* RSS keys are 40 or 52 bytes long */
 #define INTEL_RSS_KEY_LEN 52
 
@@ -88,22 +97,83 @@ enum {
 /* With up to 40 segments we should be on the save side. */
 #define kMaxSegs 40
 
+/*
+ * Extra segments for TSO buffers split at the tx fifo limit. Together
+ * with the context descriptor this must fit into kTxSpareDescs.
+ */
+#define kMaxSplitSegs 8
+
 #define kTxSpareDescs   16
 
-/* The number of descriptors must be a power of 2. */
-#define kNumTxDesc      1024        /* Number of Tx descriptors */
-#define kNumRxDesc      512         /* Number of Rx descriptors */
-#define kNumKdpDesc     kNumTxDesc  /* Number of Kdp descriptors */
-#define kTxLastDesc    (kNumTxDesc - 1)
-#define kRxLastDesc    (kNumRxDesc - 1)
-#define kTxDescMask    (kNumTxDesc - 1)
-#define kRxDescMask    (kNumRxDesc - 1)
-#define kTxDescSize    (kNumTxDesc*sizeof(struct e1000_data_desc))
-#define kRxDescSize    (kNumRxDesc*sizeof(union e1000_rx_desc_extended))
+/* Range of descriptors between two status reports with RS batching. */
+#define kTxRSMinBatch   4
+#define kTxRSMaxBatch   64
+
+/*
+ * The number of descriptors of a ring must be a power of 2. A tx ring must
+ * be able to hold the largest possible packet, see outputPacket().
+ */
+#define kNumTxDescDef   1024        /* Default number of Tx descriptors */
+#define kNumRxDescDef   512         /* Default number of Rx descriptors */
+#define kMinTxDesc      128
+#define kMinRxDesc      64
+#define kMaxNumDesc     4096
+#define kNumKdpDesc     1024        /* Number of Kdp descriptors */
+#define kTxDescSize    (numTxDesc * sizeof(struct e1000_data_desc))
+
+/* Tx bounce buffers for small packets, one per descriptor. */
+#define kTxCopyBufSize  256
+#define kTxCopySlabSize (numTxDesc * kTxCopyBufSize)
+#define kRxDescSize    (numRxDesc * sizeof(union e1000_rx_desc_extended))
 
 /* This is the receive buffer size (must be large enough to hold a packet). */
 #define kRxBufferPktSize 2048
-#define kRxNumSpareMbufs 100
+
+/*
+ * Receive buffer size for jumbo frames. Larger mbuf clusters aren't
+ * guaranteed to be physically contiguous.
+ */
+#define kRxJumboBufferSize 4096
+
+/*
+ * Packet split: the headers are placed in a buffer of kRxPsHdrSize
+ * bytes from a pre-mapped slab, the payload in up to PS_PAGE_BUFFERS
+ * jumbo buffers. Packet split descriptors are 32 bytes wide.
+ */
+#define kRxPsHdrSize    256
+#define kRxPsHdrSlabSize (numRxDesc * kRxPsHdrSize)
+#define kRxPsDescSize   (numRxDesc * sizeof(union e1000_rx_desc_packet_split))
+#define kRxPsNumPageBufs (numRxDesc * (PS_PAGE_BUFFERS - 1))
+
+/* Limits of the number of pre-mapped rx buffers kept in the recycle pool. */
+#define kRxPoolMinSize 32
+#define kRxPoolDefSize 128
+
+/* Bounds of the number of rx descriptors returned with one tail update. */
+#define kRxTailMinBatch 4
+#define kRxTailMaxBatch 64
+
+/* Maximum number of completed rx descriptors harvested in one go. */
+#define kRxBatchSize 32
+
+/* Bounds of the rx poll budget and the delay between two poll passes. */
+#define kRxPollBudgetMin 16
+#define kRxPollBudgetMax 256
+#define kRxPollDelayUS 10
+
+/* Receive interrupts masked while polling the rx ring. */
+#define kRxIntrMask (E1000_IMS_RXT0 | E1000_IMS_RXDMT0)
+
+/* Limits of the adaptive poll interval in ns and the default poll bias. */
+#define kPollIntervalMinNS 50000
+#define kPollIntervalMaxNS 1000000
+#define kPollIntervalStepNS 10000
+#define kPollBiasDef 50
+#define kPollBiasMax 100
+
+/* Number of small mbufs preallocated for rx copybreak and the largest threshold. */
+#define kRxCopyPoolSize 256
+#define kRxCopyBreakMax 512
 #define kMCFilterLimit 32
 #define kMaxRxQueques 1
 #define kMaxMtu 9000
@@ -112,8 +182,16 @@ enum {
 /* statitics timer period in ms. */
 #define kTimeoutMS 1000
 
+/* Free descriptors below which the tx interrupt is needed with inline reclaim. */
+#define kTxIntrLowWater (numTxDesc / 2)
+
+/* Bounds of the tx byte queue limit and the time a slack is held. */
+#define kTxBqlMinLimit (2 * ETH_FRAME_LEN)
+#define kTxBqlMaxLimit (1024 * 1024)
+#define kTxBqlHoldTimeMS 1000
+
 /* Treshhold value to wake a stalled queue */
-#define kTxQueueWakeTreshhold (kNumTxDesc / 4)
+#define kTxQueueWakeTreshhold (numTxDesc / 4)
 
 /* transmitter deadlock treshhold in seconds. */
 #define kTxDeadlockTreshhold 2
@@ -121,34 +199,6 @@ enum {
 /* Maximum DMA latency in ns. */
 #define kMaxDmaLatency 75000
 
-/* IP specific stuff */
-#define kMinL4HdrOffsetV4 34
-#define kMinL4HdrOffsetV6 54
-
-#define kIPv4CSumStart      ETH_HLEN
-#define kIPv4CSumOffset     (offsetof(struct iphdr, check) + kIPv4CSumStart)
-#define kIPv4CSumEnd        (sizeof(struct iphdr) + kIPv4CSumStart - 1)
-
-#define kUDPv4CSumStart     kMinL4HdrOffsetV4
-#define kUDPv4CSumOffset    (offsetof(struct udphdr, uh_sum) + kMinL4HdrOffsetV4)
-#define kUDPv4CSumEnd       0
-
-#define kTCPv4CSumStart     kMinL4HdrOffsetV4
-#define kTCPv4CSumOffset    (offsetof(struct tcphdr, th_sum) + kMinL4HdrOffsetV4)
-#define kTCPv4CSumEnd       0
-
-#define kIPv6CSumStart      ETH_HLEN
-#define kIPv6CSumOffset     0
-#define kIPv6CSumEnd        0
-
-#define kTCPv6CSumStart     kMinL4HdrOffsetV6
-#define kTCPv6CSumOffset    (offsetof(struct tcphdr, th_sum) + kMinL4HdrOffsetV6)
-#define kTCPv6CSumEnd       0
-
-#define kUDPv6CSumStart     kMinL4HdrOffsetV6
-#define kUDPv6CSumOffset    (offsetof(struct udphdr, uh_sum) + kMinL4HdrOffsetV6)
-#define kUDPv6CSumEnd       0
-
 #define SPEED_MODE_BIT (1 << 21)
 #define E1000_TARC_QUEUE_EN   0x00000400
 
@@ -182,9 +232,6 @@ enum {
 #define E1000_TX_FLAGS_VLAN_MASK    0xffff0000
 #define E1000_TX_FLAGS_VLAN_SHIFT    16
 
-#define E1000_TXD_OPTS_IXSM     0x00000100
-#define E1000_TXD_OPTS_TXSM     0x00000200
-
 #define E1000_RCTL_FLXB_SHIFT   27
 
 #define E1000_ICR_TXQE          0x00000002      /* Transmit queue empty */
@@ -196,6 +243,12 @@ enum {
 /* Transmit Absolute Interrupt Delay in units of 1.024 microseconds */
 #define DEFAULT_TADV 32
 
+/* Upper limits of the interrupt delay timers in units of 1.024 microseconds */
+#define kRxDelayTimeMax 100
+#define kRxAbsTimeMax 500
+#define kTxDelayTimeMax 0xffff
+#define kTxAbsTimeMax 0xffff
+
 /*
 #define E1000_SRPD      0x02C00
 #define E1000_RAID      0x02C08
@@ -240,10 +293,21 @@ enum
 
 #define kParamName "Driver Parameters"
 #define kEnableCSO6Name "enableCSO6"
+#define kEnableCacheableRingsName "enableCacheableRings"
+#define kEnableTSO4Name "enableTSO4"
+#define kEnableTSO6Name "enableTSO6"
+#define kForceTSOName "forceTSO"
+#define kEnableRSBatchingName "enableRSBatching"
+#define kEnableTxInlineReclaimName "enableTxInlineReclaim"
+#define kEnableTxByteLimitName "enableTxByteLimit"
 #define kEnableWoMName "enableWakeOnAddrMatch"
+#define kEnablePacketSplitName "enablePacketSplit"
+#define kEnableAdaptiveITRName "enableAdaptiveITR"
+#define kEnableAdaptivePollingName "enableAdaptivePolling"
 #define kIntrRate10Name "maxIntrRate10"
 #define kIntrRate100Name "maxIntrRate100"
 #define kIntrRate1000Name "maxIntrRate1000"
+#define kPollBiasName "pollBias"
 #define kDriverVersionName "Driver_Version"
 #define kNameLenght 64
 
@@ -255,6 +319,99 @@ enum
 #define kRxDelayTime100Name "rxDelayTime100"
 #define kRxDelayTime1000Name "rxDelayTime1000"
 
+#define kTxCopyBreakName "txCopyBreak"
+#define kTxDoorbellDescsName "txDoorbellDescs"
+#define kTxDoorbellTimeName "txDoorbellTime"
+#define kRxRingSizeName "rxRingSize"
+#define kTxRingSizeName "txRingSize"
+#define kRxCopyBreakName "rxCopyBreak"
+#define kRxPollBudgetName "rxPollBudget"
+
+#define kCoalesceName "Coalescing Parameters"
+#define kRxCoalesceUsecsName "rxCoalesceUsecs"
+#define kRxDelayTimeName "rxDelayTime"
+#define kRxAbsTimeName "rxAbsTime"
+#define kTxDelayTimeName "txDelayTime"
+#define kTxAbsTimeName "txAbsTime"
+
+#define kStatisticsName "Driver Statistics"
+#define kTxBurstHistName "txBurstSize"
+#define kTxDoorbellsSavedName "txDoorbellsSaved"
+#define kTxCopyPacketsName "txCopyPackets"
+#define kTxReclaimHistName "txReclaimBatch"
+#define kTxByteLimitName "txByteLimit"
+#define kTxInflightBytesName "txInflightBytes"
+#define kTxSoftChecksumsName "txSoftChecksums"
+#define kTxTsoFallbacksName "txTsoFallbacks"
+#define kRxPoolHitsName "rxPoolHits"
+#define kRxPoolMissesName "rxPoolMisses"
+#define kRxPoolAllocFailsName "rxPoolAllocFailures"
+#define kRxPoolSizeName "rxPoolSize"
+#define kRxCopyPacketsName "rxCopyPackets"
+#define kRxCopyAllocFailsName "rxCopyAllocFailures"
+#define kRxReplacePacketsName "rxReplacePackets"
+#define kRxSplitPacketsName "rxSplitPackets"
+#define kRxTailBatchHistName "rxTailBatch"
+#define kRxTailUrgentName "rxTailUrgent"
+#define kRxNoBuffersName "rxNoBuffers"
+#define kRxMissedPacketsName "rxMissedPackets"
+#define kRxTopFlowsName "rxTopFlows"
+#define kIntrRateName "intrRate"
+#define kRxPollPassesName "rxPollPasses"
+#define kPollIntervalName "pollInterval"
+#define kIntrDurationHistName "intrDurationUs"
+#define kRxPassHistName "rxPassPackets"
+#define kTxPassHistName "txPassDescs"
+#define kIntrCausesName "intrCauses"
+
+/* Log2 histograms: bucket n counts values in the range [2^n, 2^(n+1)). */
+#define kNumHistBuckets 8
+
+struct IntelHistogram {
+    UInt32 buckets[kNumHistBuckets];
+};
+
+/*
+ * The busiest rx flows by RSS hash. The counts are approximate: a flow
+ * which isn't in the table takes over the entry with the fewest packets
+ * and its count (space saving), so that they may be too high by at most
+ * the count of the entry replaced.
+ */
+#define kNumTopFlows 8
+
+struct IntelFlowTable {
+    UInt32 hash[kNumTopFlows];
+    UInt32 packets[kNumTopFlows];
+    UInt32 last;        /* entry of the previous packet */
+};
+
+/* Interrupt causes counted by interruptOccurred(). */
+enum {
+    kIntrCauseRx = 0,
+    kIntrCauseTx,
+    kIntrCauseLink,
+    kIntrCauseECC,
+    kIntrCauseNone,
+    kIntrCauseCount
+};
+
+/*
+ * State of the tx byte queue limit. The counters wrap around so that
+ * they must always be compared by their difference.
+ */
+struct IntelByteQueueLimit {
+    UInt64 slackStart;
+    UInt32 limit;
+    UInt32 adjLimit;        /* limit + numCompleted */
+    UInt32 numQueued;
+    UInt32 numCompleted;
+    UInt32 lastObjCnt;
+    UInt32 prevNumQueued;
+    UInt32 prevOvLimit;
+    UInt32 prevLastObjCnt;
+    UInt32 lowestSlack;
+};
+
 struct intelDevice {
     UInt16 pciDevId;
     UInt16 device;
@@ -267,13 +424,9 @@ struct intelDevice {
 struct intelTxBufferInfo {
     mbuf_t mbuf;
     UInt32 numDescs;
+    UInt32 numBytes;
     UInt32 pad;
 };
-struct intelRxBufferInfo {
-    mbuf_t mbuf;
-    IOPhysicalAddress64 phyAddr;
-};
-
 struct IntelRxDesc {
     UInt64 bufferAddr;
     UInt64 status;
@@ -342,6 +495,7 @@ public:
     virtual const OSString* newModelString() const APPLE_KEXT_OVERRIDE;
 
     virtual IOReturn selectMedium(const IONetworkMedium *medium) APPLE_KEXT_OVERRIDE;
+    virtual IOReturn setProperties(OSObject *properties) APPLE_KEXT_OVERRIDE;
     virtual bool configureInterface(IONetworkInterface *interface) APPLE_KEXT_OVERRIDE;
 
     virtual bool createWorkLoop() APPLE_KEXT_OVERRIDE;
@@ -370,26 +524,69 @@ private:
     inline void intelEnablePCIDevice(IOPCIDevice *provider);
     static IOReturn setPowerStateWakeAction(OSObject *owner, void *arg1, void *arg2, void *arg3, void *arg4);
     static IOReturn setPowerStateSleepAction(OSObject *owner, void *arg1, void *arg2, void *arg3, void *arg4);
+    static IOReturn setCoalesceAction(OSObject *owner, void *arg1, void *arg2, void *arg3, void *arg4);
+    IOReturn intelSetCoalesce(OSDictionary *dict);
+    void intelGetSpeedCoalesce(UInt32 **thrValue, UInt32 **rxDelay, UInt32 **rxAbs);
+    void publishCoalescing();
     void getParams();
     bool setupMediumDict();
     bool initEventSources(IOService *provider);
     void interruptOccurred(OSObject *client, IOInterruptEventSource *src, int count);
     void txInterrupt(IOOptionBits options = 0);
+    void intelTxReclaim();
+    void intelTxReclaimInline();
+    inline mbuf_t intelReplaceRxBuffer(struct intelRxBufferInfo *buf, UInt32 pktSize, UInt64 *addr);
+    inline mbuf_t intelCopyRxPacket(UInt32 index, UInt32 pktSize);
+    inline UInt32 intelRxHarvest(struct intelRxBatchEntry *batch, UInt32 limit);
+    inline void intelRxUpdateTail(bool pending);
+    inline void intelSetRxFlowId(mbuf_t m, UInt32 rssType, UInt32 rssHash);
+    void intelRxPoolRefill();
+    void intelRxCopyRefill();
+    void freeRxCopyPool();
+    void intelRxPoolAdjust();
+    inline union e1000_rx_desc_extended *intelRxDesc(UInt32 index);
+    void intelRxPsDescInit(UInt32 index);
+    mbuf_t intelRxPsPacket(UInt32 index, union e1000_rx_desc_packet_split *desc, UInt32 status);
+    void intelTxBqlReset();
+    inline void intelTxBqlQueued(UInt32 bytes);
+    void intelTxBqlCompleted(UInt32 bytes);
+    inline bool intelTxBqlAvail();
     void freePacketEx(mbuf_t pkt, IOOptionBits options = 0);
     void kdpStartup();
     bool isKdpPacket(UInt8 *data, UInt32 len);
 
 #ifdef __PRIVATE_SPI__
     UInt32 rxInterrupt(IONetworkInterface *interface, uint32_t maxCount, IOMbufQueue *pollQueue, void *context);
+    void intelUpdatePollParams();
+    UInt32 intelRxPsInterrupt(IONetworkInterface *interface, uint32_t maxCount, IOMbufQueue *pollQueue, UInt32 *rxBytes);
 #else
-    void rxInterrupt();
+    UInt32 rxInterrupt(UInt32 maxCount);
+    UInt32 intelRxPsInterrupt(UInt32 maxCount, UInt32 *rxBytes);
+    void rxPollTimeout(IOTimerEventSource *timer);
+    bool intelTxDoorbellDue();
+    void intelFlushTxDoorbell();
 #endif /* __PRIVATE_SPI__ */
 
     bool setupDMADescriptors();
     void freeDMADescriptors();
+    void freeRingArrays();
+    bool intelResizeRxBuffers();
+    bool setupRxPsBuffers();
+    void freeRxPsBuffers();
+    bool intelSetupRxPsMode();
+    void intelInitRxDescs();
+    bool setupTxCopyBuffers();
+    void freeTxCopyBuffers();
     void clearDescriptors();
     void checkLinkStatus();
     void updateStatistics(struct e1000_adapter *adapter);
+    void publishStatistics();
+    void addHistogram(OSDictionary *dict, const char *name, struct IntelHistogram *hist);
+    void addIntrCauses(OSDictionary *dict);
+    void addTopFlows(OSDictionary *dict);
+    void addNumber(OSDictionary *dict, const char *name, UInt64 value);
+    inline void intelHistogramAdd(struct IntelHistogram *hist, UInt32 value);
+    inline void intelFlowTableAdd(struct IntelFlowTable *table, UInt32 hash);
     void setLinkUp();
     void setLinkDown();
     bool checkForDeadlock();
@@ -423,6 +620,8 @@ private:
     void intelVlanStripEnable(struct e1000_adapter *adapter);
     void intelRssKeyFill(void *buffer, size_t len);
     void intelSetupRssHash(struct e1000_adapter *adapter);
+    void intelSetItr(struct e1000_adapter *adapter);
+    inline bool intelItrActive();
 
     void intelRestart();
     bool intelCheckLink(struct e1000_adapter *adapter);
@@ -441,6 +640,15 @@ private:
     SInt32 intelEnableEEE(struct e1000_hw *hw, UInt16 mode);
 
     inline void intelGetChecksumResult(mbuf_t m, UInt32 status);
+    inline bool intelTxContextLoaded(UInt32 ipConfig, UInt32 tcpConfig, UInt32 cmdLen, UInt32 mss);
+    inline UInt32 intelTxRSThreshold();
+    void intelTxQueueRS(UInt16 index);
+    inline void intelCopyTxPacket(mbuf_t m, UInt32 index, IOPhysicalSegment *segment);
+    bool intelSetupTxDesc(mbuf_t *m, struct intelTxDescSetup *setup);
+    UInt32 intelMapTxSegments(mbuf_t m, struct intelTxDescSetup *setup, IOPhysicalSegment *segments);
+    inline bool intelTxCopyable(mbuf_t m, struct intelTxDescSetup *setup);
+    void intelFillTxDescs(mbuf_t m, struct intelTxDescSetup *setup, IOPhysicalSegment *segments, UInt32 numSegs);
+    void intelUpdateTSOOffload();
 
     void getAddressList(struct IntelAddrData *addr);
 
@@ -462,6 +670,8 @@ private:
 
     IOInterruptEventSource *interruptSource;
     IOTimerEventSource *timerSource;
+    IOTimerEventSource *rxPollSource;
+    IOLock *txReclaimLock;
     IOEthernetInterface *netif;
     IOMemoryMap *baseMap;
     volatile void *baseAddr;
@@ -474,6 +684,8 @@ private:
     IOPhysicalAddress64 txPhyAddr;
     struct e1000_data_desc *txDescArray;
     IOMbufNaturalMemoryCursor *txMbufCursor;
+    UInt32 numTxDesc;
+    UInt16 txDescMask;
     UInt64 txDescDoneCount;
     UInt64 txDescDoneLast;
     SInt32 txNumFreeDesc;
@@ -481,7 +693,42 @@ private:
     UInt32 maxLatency;
     UInt16 txNextDescIndex;
     UInt16 txDirtyIndex;
-    UInt16 txCleanBarrierIndex;
+
+    /* descriptors with a pending status report */
+    UInt16 *txRSQueue;
+    UInt16 txRSHead;
+    UInt16 txRSTail;
+    UInt32 txDescsSinceRS;
+    UInt32 txLastWord1;
+
+    /* tx byte queue limit */
+    struct IntelByteQueueLimit txBql;
+    UInt64 txBqlHoldTime;
+
+    /* tx bounce buffers */
+    IODMACommand *txCopyDmaCmd;
+    IOBufferMemoryDescriptor *txCopyBufDesc;
+    IOPhysicalAddress64 txCopyPhyAddr;
+    UInt8 *txCopyBuffer;
+    UInt64 txCopyPackets;
+    UInt64 txSoftChecksums;
+    UInt64 txTsoFallbacks;
+    UInt32 txCopyBreak;
+
+    /* deferred doorbell (outputPacket() only) */
+    UInt64 txDeferredStart;
+    UInt64 txDoorbellTime;
+    UInt64 txDoorbellsSaved;
+    UInt32 txDeferredDescs;
+    UInt32 txDeferredPkts;
+    UInt32 txDoorbellDescs;
+
+    /* last context loaded into the hardware */
+    UInt32 txCtxIpConfig;
+    UInt32 txCtxTcpConfig;
+    UInt32 txCtxCmdLen;
+    UInt32 txCtxMss;
+    bool txCtxValid;
 
     /* receiver data */
     IODMACommand *rxDescDmaCmd;
@@ -489,19 +736,72 @@ private:
     IOPhysicalAddress64 rxPhyAddr;
     union e1000_rx_desc_extended *rxDescArray;
     IOMbufNaturalMemoryCursor *rxMbufCursor;
+    UInt32 numRxDesc;
+    UInt16 rxDescMask;
     mbuf_t rxPacketHead;
     mbuf_t rxPacketTail;
     UInt32 rxPacketSize;
+    bool rxDiscard;
     IOEthernetAddress *mcAddrList;
     UInt32 mcListCount;
+    UInt32 rxBufferSize;
     UInt16 rxNextDescIndex;
     UInt16 rxCleanedCount;
 
+    /* pool of pre-mapped rx buffers */
+    struct intelRxBufferInfo *rxPool;
+    UInt64 rxPoolHits;
+    UInt64 rxPoolMisses;
+    UInt64 rxPoolAllocFails;
+    UInt32 rxPoolCount;
+    UInt32 rxPoolTarget;
+    UInt32 rxPoolUsed;
+    UInt32 rxPoolBurst;
+
+    /* small mbufs for rx copybreak */
+    mbuf_t rxCopyPool[kRxCopyPoolSize];
+    UInt64 rxCopyPackets;
+    UInt64 rxCopyAllocFails;
+    UInt64 rxReplacePackets;
+    UInt32 rxCopyCount;
+    UInt32 rxCopyBreak;
+
+    /* packet split receive */
+    IODMACommand *rxPsHdrDmaCmd;
+    IOBufferMemoryDescriptor *rxPsHdrBufDesc;
+    IOPhysicalAddress64 rxPsHdrPhyAddr;
+    UInt8 *rxPsHdrBuffer;
+    union e1000_rx_desc_packet_split *rxPsDescArray;
+    struct intelRxBufferInfo *rxPsPageArray;
+    UInt64 rxSplitPackets;
+    UInt32 rxPsPages;
+    bool rxPsDiscard;
+
+    /* adaptive interrupt moderation */
+    UInt32 itrRate;
+    UInt16 rxItrClass;
+    UInt16 txItrClass;
+    bool itrConservative;
+
+    /* budgeted rx polling of the public KPI build */
+    UInt64 rxPollPasses;
+    UInt32 rxPollBudget;
+    bool rxPolling;
+
     /* power management data */
     unsigned long powerState;
 
     /* statistics data */
     UInt32 deadlockWarn;
+    struct IntelHistogram txBurstHist;
+    struct IntelHistogram txReclaimHist;
+    struct IntelHistogram rxTailHist;
+    struct IntelFlowTable rxTopFlows;
+    struct IntelHistogram intrDurationHist;
+    struct IntelHistogram rxPassHist;
+    struct IntelHistogram txPassHist;
+    UInt64 intrCauses[kIntrCauseCount];
+    UInt64 rxTailUrgent;
     IONetworkStats *netStats;
     IOEthernetStats *etherStats;
 
@@ -529,7 +829,16 @@ private:
 
 #ifdef __PRIVATE_SPI__
     IONetworkPacketPollingParameters pollParams;
+
+    /* load-adaptive polling parameters */
+    IONetworkPacketPollingParameters pollBaseParams;
+    UInt64 pollLastTime;
+    UInt64 pollLastPackets;
+    UInt64 pollLastBytes;
+    UInt64 pollPktRate;
+    UInt64 pollByteRate;
 #endif /* __PRIVATE_SPI__ */
+    UInt32 pollBias;
 
     /* flags */
     bool isRssSet;
@@ -549,11 +858,23 @@ private:
     bool wolActive;
     bool wolPwrOff;
     bool enableCSO6;
+    bool enableTSO4;
+    bool enableTSO6;
+    bool forceTSO;
+    bool txTsoActive;
+    bool enableRSBatching;
+    bool enableTxInlineReclaim;
+    bool enableTxByteLimit;
+    bool txIntrMasked;
     bool enableWoM;
+    bool enablePacketSplit;
+    bool enableCacheableRings;
+    bool enableAdaptiveITR;
+    bool enableAdaptivePolling;
 
     /* mbuf_t arrays */
-    struct intelTxBufferInfo txBufArray[kNumTxDesc];
-    struct intelRxBufferInfo rxBufArray[kNumRxDesc];
+    struct intelTxBufferInfo *txBufArray;
+    struct intelRxBufferInfo *rxBufArray;
 
     /* debugger array pool */
     mbuf_t kdpBufArray[kNumKdpDesc];
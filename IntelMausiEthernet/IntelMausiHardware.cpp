@@ -252,10 +252,28 @@ void IntelMausi::intelEnableIRQ(struct e1000_adapter *adapter)
 {
     struct e1000_hw *hw = &adapter->hw;
 
-    if (hw->mac.type >= e1000_pch_lpt) {
-        intelWriteMem32(E1000_IMS, IMS_ENABLE_MASK | E1000_IMS_ECCER);
+    UInt32 mask = IMS_ENABLE_MASK;
+
+    if (hw->mac.type >= e1000_pch_lpt)
+        mask |= E1000_IMS_ECCER;
+
+    /* All rx interrupts are armed again, which ends rx polling. */
+    rxPolling = false;
+
+    /*
+     * The transmit path changes txIntrMasked and the mask under
+     * txReclaimLock, see interruptOccurred().
+     */
+    if (enableTxInlineReclaim) {
+        IOLockLock(txReclaimLock);
+
+        if (txIntrMasked)
+            mask &= ~E1000_IMS_TXDW;
+
+        intelWriteMem32(E1000_IMS, mask);
+        IOLockUnlock(txReclaimLock);
     } else {
-        intelWriteMem32(E1000_IMS, IMS_ENABLE_MASK);
+        intelWriteMem32(E1000_IMS, mask);
     }
     intelFlush();
 }
@@ -541,8 +559,13 @@ void IntelMausi::intelConfigureTx(struct e1000_adapter *adapter)
     intelWriteMem32(E1000_TDH(0), 0);
     intelWriteMem32(E1000_TDT(0), 0);
 
-    txNextDescIndex = txDirtyIndex = txCleanBarrierIndex = 0;
-    txNumFreeDesc = kNumTxDesc;
+    txNextDescIndex = txDirtyIndex = txRSHead = txRSTail = 0;
+    txCtxValid = false;
+    txDescsSinceRS = 0;
+    txDeferredDescs = txDeferredPkts = 0;
+    txNumFreeDesc = numTxDesc;
+    intelTxBqlReset();
+    txIntrMasked = false;
 
     intelUpdateTxDescTail(0);
 
@@ -721,6 +744,31 @@ void IntelMausi::intelSetupRxControl(struct e1000_adapter *adapter)
             break;
     }
 
+    /* Packet split is set up by intelSetupRxPsMode() for jumbo frames. */
+    rctl &= ~E1000_RCTL_DTYP_PS;
+
+    if (rxPsPages) {
+        u32 psrctl = 0;
+
+        /* Enable Packet split descriptors */
+        rctl |= E1000_RCTL_DTYP_PS;
+
+        psrctl |= adapter->rx_ps_bsize0 >> E1000_PSRCTL_BSIZE0_SHIFT;
+
+        switch (rxPsPages) {
+            case 3:
+                psrctl |= kRxJumboBufferSize << E1000_PSRCTL_BSIZE3_SHIFT;
+                /* fall through */
+            case 2:
+                psrctl |= kRxJumboBufferSize << E1000_PSRCTL_BSIZE2_SHIFT;
+                /* fall through */
+            case 1:
+                psrctl |= kRxJumboBufferSize >> E1000_PSRCTL_BSIZE1_SHIFT;
+                break;
+        }
+        intelWriteMem32(E1000_PSRCTL, psrctl);
+    }
+
     /* Enable Extended Status in all Receive Descriptors */
     rfctl = intelReadMem32(E1000_RFCTL);
 
@@ -750,7 +798,8 @@ void IntelMausi::intelConfigureRx(struct e1000_adapter *adapter)
 {
     //struct e1000_hw *hw = &adapter->hw;
     u64 rdba = rxPhyAddr;
-    u32 rctl, rxcsum, ctrl_ext, rdlen = kRxDescSize;
+    u32 rctl, rxcsum, ctrl_ext;
+    u32 rdlen = (rxPsPages) ? kRxPsDescSize : kRxDescSize;
 
     /* disable receives while setting up the descriptors */
     rctl = intelReadMem32(E1000_RCTL);
@@ -799,9 +848,9 @@ void IntelMausi::intelConfigureRx(struct e1000_adapter *adapter)
     intelWriteMem32(E1000_RDH(0), 0);
     intelWriteMem32(E1000_RDT(0), 0);
     if (adapterData.flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
-        intelUpdateRxDescTail(kRxLastDesc);
+        intelUpdateRxDescTail(rxDescMask);
     else
-        intelWriteMem32(E1000_RDT(0), kRxLastDesc);
+        intelWriteMem32(E1000_RDT(0), rxDescMask);
 
     rxCleanedCount = rxNextDescIndex = 0;
 
@@ -1377,6 +1426,141 @@ void IntelMausi::intelSetupRssHash(struct e1000_adapter *adapter)
 }
 
 
+/**
+ * intelUpdateItr - update the dynamic ITR value based on statistics
+ * @itrSetting: current latency class
+ * @packets: the number of packets during this measurement interval
+ * @bytes: the number of bytes during this measurement interval
+ *
+ * Classify the traffic of the last interrupt interval as lowest latency
+ * (small, sparse packets), low latency or bulk and return the new class.
+ * Stepping between classes one at a time keeps the rate from oscillating.
+ *
+ * Reference: e1000_update_itr
+ */
+static unsigned int intelUpdateItr(u16 itrSetting, int packets, int bytes)
+{
+    unsigned int retval = itrSetting;
+
+    if (packets == 0)
+        return itrSetting;
+
+    switch (itrSetting) {
+        case lowest_latency:
+            /* handle TSO and jumbo frames */
+            if (bytes / packets > 8000)
+                retval = bulk_latency;
+            else if ((packets < 5) && (bytes > 512))
+                retval = low_latency;
+            break;
+
+        case low_latency:  /* 50 usec aka 20000 ints/s */
+            if (bytes > 10000) {
+                /* this if handles the TSO accounting */
+                if (bytes / packets > 8000)
+                    retval = bulk_latency;
+                else if ((packets < 10) || ((bytes / packets) > 1200))
+                    retval = bulk_latency;
+                else if ((packets > 35))
+                    retval = lowest_latency;
+            } else if (bytes / packets > 2000) {
+                retval = bulk_latency;
+            } else if (packets <= 2 && bytes < 512) {
+                retval = lowest_latency;
+            }
+            break;
+
+        case bulk_latency: /* 250 usec aka 4000 ints/s */
+            if (bytes > 25000) {
+                if (packets > 35)
+                    retval = low_latency;
+            } else if (bytes < 6000) {
+                retval = low_latency;
+            }
+            break;
+    }
+    return retval;
+}
+
+
+/**
+ * intelSetItr - retune the interrupt throttle rate
+ * @adapter: board private structure
+ *
+ * Update the latency classes of both directions from the packets and bytes
+ * counted in rxInterrupt() and txInterrupt() since the last call and write
+ * the interrupt rate of the busier class to ITR. The counters are reset
+ * afterwards. Only used at 1000 Mbps, slower links keep their configured rate.
+ * As txInterrupt() may run on the transmit path too, the tx counters are
+ * taken under txReclaimLock in that case.
+ *
+ * Reference: e1000_set_itr
+ */
+void IntelMausi::intelSetItr(struct e1000_adapter *adapter)
+{
+    u16 current_itr;
+    u32 new_itr = itrRate;
+    u32 txPackets;
+    u32 txBytes;
+
+    if (enableTxInlineReclaim)
+        IOLockLock(txReclaimLock);
+
+    txPackets = adapter->total_tx_packets;
+    txBytes = adapter->total_tx_bytes;
+    adapter->total_tx_bytes = 0;
+    adapter->total_tx_packets = 0;
+
+    if (enableTxInlineReclaim)
+        IOLockUnlock(txReclaimLock);
+
+    txItrClass = intelUpdateItr(txItrClass, txPackets, txBytes);
+
+    /* conservative mode (itr 3) eliminates the lowest_latency setting */
+    if (itrConservative && (txItrClass == lowest_latency))
+        txItrClass = low_latency;
+
+    rxItrClass = intelUpdateItr(rxItrClass, adapter->total_rx_packets, adapter->total_rx_bytes);
+
+    /* conservative mode (itr 3) eliminates the lowest_latency setting */
+    if (itrConservative && (rxItrClass == lowest_latency))
+        rxItrClass = low_latency;
+
+    current_itr = max_t(u16, rxItrClass, txItrClass);
+
+    /* counts and packets in update_itr are dependent on these numbers */
+    switch (current_itr) {
+        case lowest_latency:
+            new_itr = 70000;
+            break;
+
+        case low_latency:
+            new_itr = 20000; /* aka hwitr = ~200 */
+            break;
+
+        case bulk_latency:
+            new_itr = 4000;
+            break;
+
+        default:
+            break;
+    }
+
+    if (new_itr != itrRate) {
+        /* this attempts to bias the interrupt rate towards Bulk
+         * by adding intermediate steps when interrupt rate is
+         * increasing
+         */
+        new_itr = (new_itr > itrRate) ? min_t(u32, itrRate + (new_itr >> 2), new_itr) : new_itr;
+        itrRate = new_itr;
+
+        intelWriteMem32(E1000_ITR, 1000000000 / (new_itr * 256));
+    }
+    adapter->total_rx_bytes = 0;
+    adapter->total_rx_packets = 0;
+}
+
+
 /**
  * intelRestart
  *
@@ -1412,6 +1596,15 @@ void IntelMausi::intelRestart()
     clearDescriptors();
     rxCleanedCount = rxNextDescIndex = 0;
     deadlockWarn = 0;
+
+    /* A new MTU may require a different receive buffer size. */
+    if (adapterData.rx_buffer_len != rxBufferSize)
+        intelResizeRxBuffers();
+
+    /* It may also switch packet split on or off. */
+    if (adapterData.rx_ps_pages != rxPsPages)
+        intelSetupRxPsMode();
+
     forceReset = false;
     eeeMode = 0;
 
@@ -1435,6 +1628,16 @@ void IntelMausi::intelRestart()
  */
 void IntelMausi::intelUpdateTxDescTail(UInt32 index)
 {
+    UInt16 lastIndex;
+
+    /* The last packet handed over to the hardware must report its status. */
+    if (txDescsSinceRS) {
+        lastIndex = (index - 1) & txDescMask;
+        txDescArray[lastIndex].lower.data = OSSwapHostToLittleInt32(txLastWord1 | E1000_TXD_CMD_RS);
+        intelTxQueueRS(lastIndex);
+    }
+    intelDescBarrier();
+
     if (adapterData.flags2 & FLAG2_PCIM2PCI_ARBITER_WA) {
         struct e1000_hw *hw = &adapterData.hw;
         s32 ret = __ew32_prepare(hw);
@@ -1451,7 +1654,6 @@ void IntelMausi::intelUpdateTxDescTail(UInt32 index)
     } else {
         intelWriteMem32(E1000_TDT(0), index);
     }
-    txCleanBarrierIndex = txNextDescIndex;
 }
 
 
@@ -1546,12 +1748,13 @@ void IntelMausi::intelFlushTxRing(struct e1000_adapter *adapter)
 
     OSAddAtomic(-1, &txNumFreeDesc);
     desc = &txDescArray[txNextDescIndex++];
-    txNextDescIndex &= kTxDescMask;
+    txNextDescIndex &= txDescMask;
 
     desc->buffer_addr = OSSwapHostToLittleInt64(txPhyAddr);
     desc->lower.data = OSSwapHostToLittleInt32(txd_lower | size);
     desc->upper.data = 0;
 
+    intelDescBarrier();
     intelWriteMem32(E1000_TDT(0), txNextDescIndex);
     intelFlush();
     usleep_range(200, 250);
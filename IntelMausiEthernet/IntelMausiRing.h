@@ -0,0 +1,533 @@
+/* IntelMausiRing.h -- Descriptor ring helpers of the IntelMausi driver.
+ *
+ * Copyright (c) 2014 Laura Müller <laura-mueller@uni-duesseldorf.de>
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Driver for Intel PCIe gigabit ethernet controllers.
+ *
+ * This driver is based on Intel's E1000e driver for Linux.
+ *
+ * The functions in this file don't depend on the state of the driver
+ * instance. Besides the mbuf KPI they only operate on packet headers and
+ * descriptors so that they can be built by the host tests in Tests/ too.
+ */
+
+#ifndef IntelMausiRing_h
+#define IntelMausiRing_h
+
+/* IP specific stuff */
+#define kVlanHdrLen 4
+#define kMaxVlanTags 2
+#define kMaxIPv6ExtHdrs 8
+
+/* Offset fields of the tx context descriptor are only 8 bits wide. */
+#define kMaxTxCSumOffset 0xff
+
+#define E1000_TXD_OPTS_IXSM     0x00000100
+#define E1000_TXD_OPTS_TXSM     0x00000200
+
+#define E1000_RXDEXT_RSSTYPE_MASK   0x0000000F      /* RSS type in the MRQ field */
+
+/* Classes of checksum offload, see txOffloadInfo. */
+enum {
+    kTxOffloadNone = 0,
+    kTxOffloadTCPv4,
+    kTxOffloadUDPv4,
+    kTxOffloadIPv4,
+    kTxOffloadTCPv6,
+    kTxOffloadUDPv6,
+    kTxOffloadCount
+};
+
+/* Results of the descriptor setup of a packet. */
+enum {
+    kTxSetupDone = 0,
+    kTxSetupUnsupported,    /* the hardware can't handle the headers */
+    kTxSetupDropped         /* mbuf_pullup() failed and freed the packet */
+};
+
+struct intelTxOffloadInfo {
+    UInt32 cmdLen;
+    UInt32 word2;
+    UInt16 etherType;       /* network protocol */
+    UInt8 l4Proto;          /* transport protocol or 0 */
+    UInt8 l4CSumOffset;     /* offset of the checksum in the transport header */
+};
+
+struct intelRxBufferInfo {
+    mbuf_t mbuf;
+    IOPhysicalAddress64 phyAddr;
+};
+
+/* Write-back data of a completed rx descriptor, see intelRxHarvestDescs(). */
+struct intelRxBatchEntry {
+    UInt32 status;
+    UInt16 length;
+    UInt16 vlan;
+    UInt32 rssType;
+    UInt32 rssHash;
+};
+
+/* Descriptor setup of a packet shared by all transmit paths. */
+struct intelTxDescSetup {
+    UInt32 cmd;
+    UInt32 opts;
+    UInt32 word2;
+    UInt32 ipConfig;
+    UInt32 tcpConfig;
+    UInt32 cmdLen;
+    UInt32 mss;
+    UInt32 numDescs;    /* number of context descriptors (0 or 1) */
+    UInt32 pktLen;
+    bool tso;
+};
+
+/*
+ * Command bits and headers of each class of checksum offload. The offsets
+ * of the context descriptor are taken from the headers of the packet, see
+ * intelTxParseHeaders().
+ */
+static constexpr struct intelTxOffloadInfo txOffloadInfo[kTxOffloadCount] = {
+    /* kTxOffloadNone */
+    { 0, 0, 0, 0, 0 },
+    /* kTxOffloadTCPv4 */
+    {
+        (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP | E1000_TXD_CMD_TCP),
+        (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM),
+        ETH_P_IP, IPPROTO_TCP, offsetof(struct tcphdr, th_sum)
+    },
+    /* kTxOffloadUDPv4 */
+    {
+        (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP),
+        (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM),
+        ETH_P_IP, IPPROTO_UDP, offsetof(struct udphdr, uh_sum)
+    },
+    /* kTxOffloadIPv4 */
+    {
+        (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_IP),
+        E1000_TXD_OPTS_IXSM,
+        ETH_P_IP, 0, 0
+    },
+    /* kTxOffloadTCPv6 */
+    {
+        (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_TCP),
+        E1000_TXD_OPTS_TXSM,
+        ETH_P_IPV6, IPPROTO_TCP, offsetof(struct tcphdr, th_sum)
+    },
+    /* kTxOffloadUDPv6 */
+    {
+        E1000_TXD_CMD_DEXT,
+        E1000_TXD_OPTS_TXSM,
+        ETH_P_IPV6, IPPROTO_UDP, offsetof(struct udphdr, uh_sum)
+    },
+};
+
+static inline UInt32 intelTxOffloadClass(UInt32 offloadFlags)
+{
+    UInt32 result = kTxOffloadNone;
+
+    if (offloadFlags & kChecksumTCP)
+        result = kTxOffloadTCPv4;
+    else if (offloadFlags & kChecksumUDP)
+        result = kTxOffloadUDPv4;
+    else if (offloadFlags & kChecksumIP)
+        result = kTxOffloadIPv4;
+    else if (offloadFlags & kChecksumTCPIPv6)
+        result = kTxOffloadTCPv6;
+    else if (offloadFlags & kChecksumUDPIPv6)
+        result = kTxOffloadUDPv6;
+
+    return result;
+}
+
+/*
+ * Return a pointer to len bytes of the packet headers at offset. They are
+ * usually located in the first mbuf so that a copy is rarely needed.
+ */
+static inline const UInt8 *intelTxHdrData(mbuf_t m, UInt32 offset, UInt32 len, UInt8 *buffer)
+{
+    const UInt8 *result = NULL;
+
+    if ((offset + len) <= mbuf_len(m))
+        result = (const UInt8 *)mbuf_data(m) + offset;
+    else if (!mbuf_copydata(m, offset, len, buffer))
+        result = buffer;
+
+    return result;
+}
+
+/*
+ * Locate the network and the transport header of a packet requesting
+ * checksum offload. In-band VLAN tags, IPv4 options and IPv6 extension
+ * headers are skipped. Returns false in case the headers don't match the
+ * requested offload or can't be handled by the hardware, e.g. because of
+ * an IPv6 fragment header or offsets exceeding the context descriptor.
+ */
+static inline bool intelTxParseHeaders(mbuf_t m, const struct intelTxOffloadInfo *info, UInt32 *l3Offset, UInt32 *l4Offset)
+{
+    const UInt8 *data;
+    UInt8 buffer[10];
+    UInt32 offset = ETH_HLEN;
+    UInt32 i;
+    UInt16 type;
+    UInt8 proto;
+    bool result = false;
+
+    *l3Offset = ETH_HLEN;
+
+    if (!(data = intelTxHdrData(m, ETH_HLEN - 2, 2, buffer)))
+        goto done;
+
+    type = ((data[0] << 8) | data[1]);
+
+    for (i = 0; (i < kMaxVlanTags) && ((type == ETH_P_8021Q) || (type == ETH_P_8021AD)); i++) {
+        if (!(data = intelTxHdrData(m, offset + 2, 2, buffer)))
+            goto done;
+
+        type = ((data[0] << 8) | data[1]);
+        offset += kVlanHdrLen;
+    }
+    *l3Offset = offset;
+
+    if (type != info->etherType)
+        goto done;
+
+    if (type == ETH_P_IP) {
+        if (!(data = intelTxHdrData(m, offset, 10, buffer)))
+            goto done;
+
+        if (((data[0] >> 4) != 4) || ((data[0] & 0x0f) < 5))
+            goto done;
+
+        proto = data[9];
+        offset += ((data[0] & 0x0f) << 2);
+    } else {
+        if (!(data = intelTxHdrData(m, offset, 8, buffer)))
+            goto done;
+
+        proto = data[6];
+        offset += sizeof(struct ip6_hdr);
+
+        for (i = 0; i < kMaxIPv6ExtHdrs; i++) {
+            if ((proto != IPPROTO_HOPOPTS) && (proto != IPPROTO_ROUTING) &&
+                (proto != IPPROTO_DSTOPTS) && (proto != IPPROTO_AH))
+                break;
+
+            if (!(data = intelTxHdrData(m, offset, 2, buffer)))
+                goto done;
+
+            offset += (proto == IPPROTO_AH) ? ((data[1] + 2) << 2) : ((data[1] + 1) << 3);
+            proto = data[0];
+        }
+    }
+    *l4Offset = offset;
+
+    if (info->l4Proto && (proto != info->l4Proto))
+        goto done;
+
+    result = ((offset + info->l4CSumOffset) <= kMaxTxCSumOffset);
+
+done:
+    return result;
+}
+
+/*
+ * Setup the checksum offload context of a packet of class cls. Each class
+ * gets its own instance in which the command bits, the headers to look for
+ * and the layout of the configuration words are compile time constants.
+ * Only the header offsets are taken from the packet. Returns
+ * kTxSetupUnsupported in case the hardware can't handle the headers with
+ * the offset of the network header in *l3Offset.
+ */
+template <UInt32 cls>
+static inline UInt32 intelTxSetupCsum(mbuf_t m, struct intelTxDescSetup *setup, UInt32 *l3Offset)
+{
+    constexpr UInt32 cmdLen = txOffloadInfo[cls].cmdLen;
+    constexpr UInt32 word2 = txOffloadInfo[cls].word2;
+    constexpr UInt16 etherType = txOffloadInfo[cls].etherType;
+    constexpr UInt8 l4Proto = txOffloadInfo[cls].l4Proto;
+    constexpr UInt8 l4CSumOffset = txOffloadInfo[cls].l4CSumOffset;
+    UInt32 l4Offset;
+    UInt32 result = kTxSetupDone;
+
+    if (!cmdLen)
+        goto done;
+
+    if (!intelTxParseHeaders(m, &txOffloadInfo[cls], l3Offset, &l4Offset)) {
+        result = kTxSetupUnsupported;
+        goto done;
+    }
+    setup->cmd = (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D);
+    setup->cmdLen = cmdLen;
+    setup->word2 = word2;
+
+    if (etherType == ETH_P_IP)
+        setup->ipConfig = (((l4Offset - 1) << 16) | ((*l3Offset + offsetof(struct ip, ip_sum)) << 8) | *l3Offset);
+    else
+        setup->ipConfig = *l3Offset;
+
+    if (l4Proto)
+        setup->tcpConfig = (((l4Offset + l4CSumOffset) << 8) | l4Offset);
+    else
+        setup->tcpConfig = 0;
+
+done:
+    return result;
+}
+
+typedef UInt32 (*intelTxSetupFunc)(mbuf_t m, struct intelTxDescSetup *setup, UInt32 *l3Offset);
+
+/* Checksum offload setup of each class, indexed by intelTxOffloadClass(). */
+static const intelTxSetupFunc txSetupFuncs[kTxOffloadCount] = {
+    intelTxSetupCsum<kTxOffloadNone>,
+    intelTxSetupCsum<kTxOffloadTCPv4>,
+    intelTxSetupCsum<kTxOffloadUDPv4>,
+    intelTxSetupCsum<kTxOffloadIPv4>,
+    intelTxSetupCsum<kTxOffloadTCPv6>,
+    intelTxSetupCsum<kTxOffloadUDPv6>,
+};
+
+/*
+ * Prepare the headers of a TSO packet the way the hardware expects them:
+ * the IP length fields must be zero and the TCP checksum field has to be
+ * seeded with the pseudo header checksum without the length. l4Offset is
+ * the offset of the TCP header as found by intelTxParseHeaders(), i.e.
+ * behind the IPv4 options. Returns the total header length or 0 in case
+ * the headers couldn't be accessed in which case the packet has already
+ * been freed by mbuf_pullup().
+ *
+ * Reference: e1000_tso
+ */
+static inline UInt32 intelTxPrepareTSO(mbuf_t *m, UInt32 tsoFlags, UInt32 l4Offset, UInt32 *ipConfig, UInt32 *tcpConfig)
+{
+    struct ip *ipHdr;
+    struct ip6_hdr *ip6Hdr;
+    struct tcphdr *tcpHdr;
+    UInt16 *addr;
+    UInt32 csum32 = IPPROTO_TCP;
+    UInt32 addrOffset;
+    UInt32 hdrLen;
+    UInt32 numWords;
+    UInt32 i;
+
+    hdrLen = l4Offset + sizeof(struct tcphdr);
+
+    /* The stack usually puts all headers into the first mbuf. */
+    if ((mbuf_len(*m) < hdrLen) && mbuf_pullup(m, hdrLen))
+        goto error;
+
+    tcpHdr = (struct tcphdr *)((UInt8 *)mbuf_data(*m) + l4Offset);
+    hdrLen = l4Offset + (tcpHdr->th_off << 2);
+
+    /* Make sure that the TCP options are in the first mbuf too. */
+    if ((mbuf_len(*m) < hdrLen) && mbuf_pullup(m, hdrLen))
+        goto error;
+
+    if (tsoFlags & MBUF_TSO_IPV4) {
+        ipHdr = (struct ip *)((UInt8 *)mbuf_data(*m) + ETH_HLEN);
+
+        ipHdr->ip_len = 0;
+        ipHdr->ip_sum = 0;
+        addrOffset = ETH_HLEN + offsetof(struct ip, ip_src);
+        numWords = 4;
+
+        *ipConfig = (((l4Offset - 1) << 16) | ((ETH_HLEN + offsetof(struct ip, ip_sum)) << 8) | ETH_HLEN);
+    } else {
+        ip6Hdr = (struct ip6_hdr *)((UInt8 *)mbuf_data(*m) + ETH_HLEN);
+
+        ip6Hdr->ip6_plen = 0;
+        addrOffset = ETH_HLEN + offsetof(struct ip6_hdr, ip6_src);
+        numWords = 16;
+
+        *ipConfig = ETH_HLEN;
+    }
+    tcpHdr = (struct tcphdr *)((UInt8 *)mbuf_data(*m) + l4Offset);
+    addr = (UInt16 *)((UInt8 *)mbuf_data(*m) + addrOffset);
+
+    /* Pseudo header checksum without length. */
+    for (i = 0; i < numWords; i++)
+        csum32 += ntohs(addr[i]);
+
+    csum32 = (csum32 >> 16) + (csum32 & 0xffff);
+    csum32 += (csum32 >> 16);
+    tcpHdr->th_sum = htons((UInt16)csum32);
+
+    *tcpConfig = (((l4Offset + offsetof(struct tcphdr, th_sum)) << 8) | l4Offset);
+
+done:
+    return hdrLen;
+
+error:
+    *m = NULL;
+    hdrLen = 0;
+    goto done;
+}
+
+/*
+ * Setup the descriptors of a TSO packet. intelTxPrepareTSO() expects an
+ * untagged ethernet header followed by the IP header and, in case of IPv6,
+ * no extension headers. IPv4 options are fine. Returns kTxSetupUnsupported
+ * in case the packet doesn't match, leaving it untouched.
+ */
+static inline UInt32 intelTxSetupTSO(mbuf_t *m, UInt32 tsoFlags, UInt32 mss, struct intelTxDescSetup *setup)
+{
+    UInt32 l3Offset;
+    UInt32 l4Offset;
+    UInt32 hdrLen;
+    UInt32 result = kTxSetupUnsupported;
+
+    if (tsoFlags & MBUF_TSO_IPV4) {
+        if (!intelTxParseHeaders(*m, &txOffloadInfo[kTxOffloadTCPv4], &l3Offset, &l4Offset) ||
+            (l3Offset != ETH_HLEN))
+            goto done;
+    } else {
+        if (!intelTxParseHeaders(*m, &txOffloadInfo[kTxOffloadTCPv6], &l3Offset, &l4Offset) ||
+            (l3Offset != ETH_HLEN) || (l4Offset != (ETH_HLEN + sizeof(struct ip6_hdr))))
+            goto done;
+    }
+    hdrLen = intelTxPrepareTSO(m, tsoFlags, l4Offset, &setup->ipConfig, &setup->tcpConfig);
+
+    if (!hdrLen) {
+        result = kTxSetupDropped;
+        goto done;
+    }
+    setup->cmd = (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D | E1000_TXD_CMD_TSE);
+    setup->cmdLen = (E1000_TXD_CMD_DEXT | E1000_TXD_CMD_TSE | E1000_TXD_CMD_TCP | ((UInt32)mbuf_pkthdr_len(*m) - hdrLen));
+    setup->mss = ((mss << 16) | (hdrLen << 8));
+
+    if (tsoFlags & MBUF_TSO_IPV4) {
+        setup->cmdLen |= E1000_TXD_CMD_IP;
+        setup->word2 = (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM);
+    } else {
+        setup->word2 = E1000_TXD_OPTS_TXSM;
+    }
+    /* TSO packets always get a new context. */
+    setup->numDescs = 1;
+    setup->tso = true;
+    result = kTxSetupDone;
+
+done:
+    return result;
+}
+
+/*
+ * The maximum buffer size of a tx descriptor is limited by the transmit
+ * allocation of the packet buffer (see intelReset()). Split segments of
+ * large TSO packets exceeding this limit in place. Returns the new number
+ * of segments or 0 in case maxSegs isn't sufficient.
+ *
+ * Reference: e1000_tx_map
+ */
+static inline UInt32 intelTxSplitSegments(IOPhysicalSegment *segments, UInt32 numSegs, UInt32 maxSegs, UInt32 limit)
+{
+    IOPhysicalAddress location;
+    UInt32 length;
+    UInt32 total = 0;
+    UInt32 index;
+    UInt32 n;
+    UInt32 i;
+
+    for (i = 0; i < numSegs; i++)
+        total += (segments[i].length + limit - 1) / limit;
+
+    if (total == numSegs)
+        goto done;
+
+    if (total > maxSegs) {
+        total = 0;
+        goto done;
+    }
+    /* Expand the array from the end so that no segment gets overwritten. */
+    index = total;
+
+    for (i = numSegs; i-- > 0;) {
+        location = segments[i].location;
+        length = segments[i].length;
+        n = (length + limit - 1) / limit;
+        index -= n;
+
+        for (n = index; length > limit; n++) {
+            segments[n].location = location;
+            segments[n].length = limit;
+            location += limit;
+            length -= limit;
+        }
+        segments[n].location = location;
+        segments[n].length = length;
+    }
+
+done:
+    return total;
+}
+
+/* Fill in the context descriptor of a packet. */
+static inline void intelTxWriteContext(struct e1000_context_desc *desc, const struct intelTxDescSetup *setup)
+{
+    desc->lower_setup.ip_config = OSSwapHostToLittleInt32(setup->ipConfig);
+    desc->upper_setup.tcp_config = OSSwapHostToLittleInt32(setup->tcpConfig);
+    desc->cmd_and_length = OSSwapHostToLittleInt32(setup->cmdLen);
+    desc->tcp_seg_setup.data = OSSwapHostToLittleInt32(setup->mss);
+}
+
+/*
+ * Fill in a data descriptor of a packet. opts are the command bits of the
+ * last descriptor or 0. Returns the descriptor's command and length word.
+ */
+static inline UInt32 intelTxWriteData(struct e1000_data_desc *desc, const struct intelTxDescSetup *setup, const IOPhysicalSegment *segment, UInt32 opts)
+{
+    UInt32 word1 = (setup->cmd | opts | (segment->length & 0x000fffff));
+
+    desc->buffer_addr = OSSwapHostToLittleInt64(segment->location);
+    desc->lower.data = OSSwapHostToLittleInt32(word1);
+    desc->upper.data = OSSwapHostToLittleInt32(setup->word2);
+
+    return word1;
+}
+
+/*
+ * First phase of receive: collect the write-back data of up to limit
+ * completed descriptors of ring descs, starting at index. As the ring may
+ * be uncached, each half of the write-back is fetched with a single read.
+ * The data of the buffers is prefetched while we are at it so that it is
+ * in the cache by the time the second phase gets to it.
+ */
+static inline UInt32 intelRxHarvestDescs(union e1000_rx_desc_extended *descs, const struct intelRxBufferInfo *bufs, UInt32 index, UInt32 mask, struct intelRxBatchEntry *batch, UInt32 limit)
+{
+    UInt64 upper;
+    UInt64 lower;
+    UInt32 n = 0;
+
+    while (n < limit) {
+        upper = OSSwapLittleToHostInt64(*(volatile UInt64 *)&descs[index].wb.upper);
+
+        if (!(upper & E1000_RXD_STAT_DD))
+            break;
+
+        batch[n].status = (UInt32)upper;
+        batch[n].length = (UInt16)(upper >> 32);
+        batch[n].vlan = (UInt16)(upper >> 48);
+
+        /* The lower half holds the RSS type and hash. */
+        lower = OSSwapLittleToHostInt64(*(volatile UInt64 *)&descs[index].wb.lower);
+        batch[n].rssType = (UInt32)lower & E1000_RXDEXT_RSSTYPE_MASK;
+        batch[n].rssHash = (UInt32)(lower >> 32);
+
+        __builtin_prefetch(mbuf_data(bufs[index].mbuf));
+
+        ++index &= mask;
+        n++;
+    }
+    return n;
+}
+
+#endif /* IntelMausiRing_h */
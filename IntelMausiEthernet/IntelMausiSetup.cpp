@@ -60,16 +60,40 @@ static const char *offName = "disabled";
 
 #pragma mark --- data structure initialization methods ---
 
+static UInt32 getRingSize(OSNumber *num, UInt32 minSize, UInt32 defSize)
+{
+    UInt32 size = defSize;
+
+    if (num) {
+        size = num->unsigned32BitValue();
+
+        if ((size < minSize) || (size > kMaxNumDesc) || (size & (size - 1))) {
+            IOLog("[IntelMausi]: Invalid ring size %u. Using %u.\n", size, defSize);
+            size = defSize;
+        }
+    }
+    return size;
+}
+
 void IntelMausi::getParams()
 {
     OSDictionary *params;
     OSString *versionString;
     OSNumber *num;
     OSBoolean *csoV6;
+    OSBoolean *tso;
+    OSBoolean *rsBatching;
+    OSBoolean *inlineReclaim;
+    OSBoolean *byteLimit;
     OSBoolean *wom;
+    OSBoolean *packetSplit;
+    OSBoolean *cacheableRings;
+    OSBoolean *adaptiveItr;
+    OSBoolean *adaptivePolling;
     UInt32 newIntrRate10;
     UInt32 newIntrRate100;
     UInt32 newIntrRate1000;
+    UInt32 newDoorbellTime;
 
     versionString = OSDynamicCast(OSString, getProperty(kDriverVersionName));
 
@@ -77,15 +101,76 @@ void IntelMausi::getParams()
 
     if (params) {
         csoV6 = OSDynamicCast(OSBoolean, params->getObject(kEnableCSO6Name));
-        enableCSO6 = (csoV6) ? csoV6->getValue() : false;
+        enableCSO6 = (csoV6) ? csoV6->getValue() : true;
 
         DebugLog("[IntelMausi]: TCP/IPv6 checksum offload %s.\n", enableCSO6 ? onName : offName);
 
+        tso = OSDynamicCast(OSBoolean, params->getObject(kEnableTSO4Name));
+        enableTSO4 = (tso) ? tso->getValue() : false;
+
+        DebugLog("[IntelMausi]: TCP/IPv4 segmentation offload %s.\n", enableTSO4 ? onName : offName);
+
+        tso = OSDynamicCast(OSBoolean, params->getObject(kEnableTSO6Name));
+        enableTSO6 = (tso) ? tso->getValue() : false;
+
+        DebugLog("[IntelMausi]: TCP/IPv6 segmentation offload %s.\n", enableTSO6 ? onName : offName);
+
+        tso = OSDynamicCast(OSBoolean, params->getObject(kForceTSOName));
+        forceTSO = (tso) ? tso->getValue() : false;
+
+        DebugLog("[IntelMausi]: Forced segmentation offload %s.\n", forceTSO ? onName : offName);
+
+        rsBatching = OSDynamicCast(OSBoolean, params->getObject(kEnableRSBatchingName));
+        enableRSBatching = (rsBatching) ? rsBatching->getValue() : true;
+
+        DebugLog("[IntelMausi]: RS bit batching %s.\n", enableRSBatching ? onName : offName);
+
+        inlineReclaim = OSDynamicCast(OSBoolean, params->getObject(kEnableTxInlineReclaimName));
+        enableTxInlineReclaim = (inlineReclaim) ? inlineReclaim->getValue() : false;
+
+        DebugLog("[IntelMausi]: Inline tx reclaim %s.\n", enableTxInlineReclaim ? onName : offName);
+
+        byteLimit = OSDynamicCast(OSBoolean, params->getObject(kEnableTxByteLimitName));
+        enableTxByteLimit = (byteLimit) ? byteLimit->getValue() : true;
+
+        DebugLog("[IntelMausi]: Tx byte queue limit %s.\n", enableTxByteLimit ? onName : offName);
+
         wom = OSDynamicCast(OSBoolean, params->getObject(kEnableWoMName));
         enableWoM = (wom) ? wom->getValue() : false;
 
         DebugLog("[IntelMausi]: Wake on address match %s.\n", enableWoM ? onName : offName);
 
+        packetSplit = OSDynamicCast(OSBoolean, params->getObject(kEnablePacketSplitName));
+        enablePacketSplit = (packetSplit) ? packetSplit->getValue() : false;
+
+        DebugLog("[IntelMausi]: Packet split receive %s.\n", enablePacketSplit ? onName : offName);
+
+        cacheableRings = OSDynamicCast(OSBoolean, params->getObject(kEnableCacheableRingsName));
+        enableCacheableRings = (cacheableRings) ? cacheableRings->getValue() : false;
+
+        DebugLog("[IntelMausi]: Cacheable descriptor rings %s.\n", enableCacheableRings ? onName : offName);
+
+        adaptiveItr = OSDynamicCast(OSBoolean, params->getObject(kEnableAdaptiveITRName));
+        enableAdaptiveITR = (adaptiveItr) ? adaptiveItr->getValue() : false;
+
+        DebugLog("[IntelMausi]: Adaptive interrupt moderation %s.\n", enableAdaptiveITR ? onName : offName);
+
+        adaptivePolling = OSDynamicCast(OSBoolean, params->getObject(kEnableAdaptivePollingName));
+        enableAdaptivePolling = (adaptivePolling) ? adaptivePolling->getValue() : false;
+
+        DebugLog("[IntelMausi]: Adaptive polling parameters %s.\n", enableAdaptivePolling ? onName : offName);
+
+        /* Get the poll bias, 0 favors latency and 100 throughput. */
+        num = OSDynamicCast(OSNumber, params->getObject(kPollBiasName));
+        pollBias = kPollBiasDef;
+
+        if (num) {
+            pollBias = num->unsigned32BitValue();
+
+            if (pollBias > kPollBiasMax)
+                pollBias = kPollBiasMax;
+        }
+
         /* Get maximum interrupt rate for 10M. */
         num = OSDynamicCast(OSNumber, params->getObject(kIntrRate10Name));
         newIntrRate10 = 3000;
@@ -134,7 +219,7 @@ void IntelMausi::getParams()
         if (num) {
             rxAbsTime10 = num->unsigned32BitValue();
 
-            if (rxAbsTime10 > 500)
+            if (rxAbsTime10 > kRxAbsTimeMax)
                 rxAbsTime10 = 0;
         } else {
             rxAbsTime10 = 0;
@@ -145,7 +230,7 @@ void IntelMausi::getParams()
         if (num) {
             rxAbsTime100 = num->unsigned32BitValue();
 
-            if (rxAbsTime100 > 500)
+            if (rxAbsTime100 > kRxAbsTimeMax)
                 rxAbsTime100 = 0;
         } else {
             rxAbsTime100 = 0;
@@ -156,7 +241,7 @@ void IntelMausi::getParams()
         if (num) {
             rxAbsTime1000 = num->unsigned32BitValue();
 
-            if (rxAbsTime1000 > 500)
+            if (rxAbsTime1000 > kRxAbsTimeMax)
                 rxAbsTime1000 = 0;
         } else {
             rxAbsTime1000 = 0;
@@ -168,7 +253,7 @@ void IntelMausi::getParams()
         if (num) {
             rxDelayTime10 = num->unsigned32BitValue();
 
-            if (rxDelayTime10 > 100)
+            if (rxDelayTime10 > kRxDelayTimeMax)
                 rxDelayTime10 = 0;
         } else {
             rxDelayTime10 = 0;
@@ -179,7 +264,7 @@ void IntelMausi::getParams()
         if (num) {
             rxDelayTime100 = num->unsigned32BitValue();
 
-            if (rxDelayTime100 > 100)
+            if (rxDelayTime100 > kRxDelayTimeMax)
                 rxDelayTime100 = 0;
         } else {
             rxDelayTime100 = 0;
@@ -190,15 +275,84 @@ void IntelMausi::getParams()
         if (num) {
             rxDelayTime1000 = num->unsigned32BitValue();
 
-            if (rxDelayTime1000 > 100)
+            if (rxDelayTime1000 > kRxDelayTimeMax)
                 rxDelayTime1000 = 0;
         } else {
             rxDelayTime1000 = 0;
         }
+
+        /* Get the tx copybreak threshold. */
+        num = OSDynamicCast(OSNumber, params->getObject(kTxCopyBreakName));
+        txCopyBreak = kTxCopyBufSize;
+
+        if (num) {
+            txCopyBreak = num->unsigned32BitValue();
+
+            if (txCopyBreak > kTxCopyBufSize)
+                txCopyBreak = kTxCopyBufSize;
+        }
+        /* Get the rx copybreak threshold. */
+        num = OSDynamicCast(OSNumber, params->getObject(kRxCopyBreakName));
+        rxCopyBreak = 256;
+
+        if (num) {
+            rxCopyBreak = num->unsigned32BitValue();
+
+            if (rxCopyBreak > kRxCopyBreakMax)
+                rxCopyBreak = kRxCopyBreakMax;
+        }
+        /* Get the number of packets processed per rx pass under load, 0 disables polling. */
+        num = OSDynamicCast(OSNumber, params->getObject(kRxPollBudgetName));
+        rxPollBudget = 0;
+
+        if (num) {
+            rxPollBudget = num->unsigned32BitValue();
+
+            if (rxPollBudget && (rxPollBudget < kRxPollBudgetMin))
+                rxPollBudget = kRxPollBudgetMin;
+            else if (rxPollBudget > kRxPollBudgetMax)
+                rxPollBudget = kRxPollBudgetMax;
+        }
+        /* Get the number of descriptors which may be queued before the tail is updated. */
+        num = OSDynamicCast(OSNumber, params->getObject(kTxDoorbellDescsName));
+        txDoorbellDescs = 64;
+
+        if (num) {
+            txDoorbellDescs = num->unsigned32BitValue();
+
+            if (txDoorbellDescs > 256)
+                txDoorbellDescs = 256;
+        }
+        /* Get the maximum time in us a tail update may be deferred. */
+        num = OSDynamicCast(OSNumber, params->getObject(kTxDoorbellTimeName));
+        newDoorbellTime = 50;
+
+        if (num)
+            newDoorbellTime = num->unsigned32BitValue();
+
+        if (newDoorbellTime < 10)
+            newDoorbellTime = 10;
+        else if (newDoorbellTime > 1000)
+            newDoorbellTime = 1000;
+
+        /* Get the ring sizes. */
+        numTxDesc = getRingSize(OSDynamicCast(OSNumber, params->getObject(kTxRingSizeName)), kMinTxDesc, kNumTxDescDef);
+        numRxDesc = getRingSize(OSDynamicCast(OSNumber, params->getObject(kRxRingSizeName)), kMinRxDesc, kNumRxDescDef);
     } else {
         /* Use default values in case of missing config data. */
-        enableCSO6 = false;
+        enableCSO6 = true;
+        enableTSO4 = false;
+        enableTSO6 = false;
+        forceTSO = false;
+        enableRSBatching = true;
+        enableTxInlineReclaim = false;
+        enableTxByteLimit = true;
         enableWoM = false;
+        enablePacketSplit = false;
+        enableCacheableRings = false;
+        enableAdaptiveITR = false;
+        enableAdaptivePolling = false;
+        pollBias = kPollBiasDef;
         newIntrRate10 = 3000;
         newIntrRate100 = 5000;
         newIntrRate1000 = 7000;
@@ -211,7 +365,25 @@ void IntelMausi::getParams()
         rxDelayTime10 = 0;
         rxDelayTime100 = 0;
         rxDelayTime1000 = 0;
+        txCopyBreak = kTxCopyBufSize;
+        rxCopyBreak = 256;
+        rxPollBudget = 0;
+        txDoorbellDescs = 64;
+        newDoorbellTime = 50;
+        numTxDesc = kNumTxDescDef;
+        numRxDesc = kNumRxDescDef;
     }
+    nanoseconds_to_absolutetime(newDoorbellTime * 1000ULL, &txDoorbellTime);
+    txDescMask = numTxDesc - 1;
+    rxDescMask = numRxDesc - 1;
+
+    DebugLog("[IntelMausi]: txRingSize=%u, rxRingSize=%u.\n", numTxDesc, numRxDesc);
+
+    DebugLog("[IntelMausi]: rxCopyBreak=%u, txCopyBreak=%u, txDoorbellDescs=%u, txDoorbellTime=%uus.\n", rxCopyBreak, txCopyBreak, txDoorbellDescs, newDoorbellTime);
+
+#ifndef __PRIVATE_SPI__
+    DebugLog("[IntelMausi]: rxPollBudget=%u.\n", rxPollBudget);
+#endif /* __PRIVATE_SPI__ */
 
     DebugLog("[IntelMausi]: rxAbsTime10=%u, rxAbsTime100=%u, rxAbsTime1000=%u, rxDelayTime10=%u, rxDelayTime100=%u, rxDelayTime1000=%u. \n", rxAbsTime10, rxAbsTime100, rxAbsTime1000, rxDelayTime10, rxDelayTime100, rxDelayTime1000);
 
@@ -312,11 +484,27 @@ bool IntelMausi::initEventSources(IOService *provider)
     }
     workLoop->addEventSource(timerSource);
 
+#ifndef __PRIVATE_SPI__
+    rxPollSource = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &IntelMausi::rxPollTimeout));
+
+    if (!rxPollSource) {
+        IOLog("[IntelMausi]: Failed to create rx poll IOTimerEventSource.\n");
+        goto error3;
+    }
+    workLoop->addEventSource(rxPollSource);
+#endif /* __PRIVATE_SPI__ */
+
     result = true;
 
 done:
     return result;
 
+#ifndef __PRIVATE_SPI__
+error3:
+    workLoop->removeEventSource(timerSource);
+    RELEASE(timerSource);
+#endif /* __PRIVATE_SPI__ */
+
 error2:
     workLoop->removeEventSource(interruptSource);
     RELEASE(interruptSource);
@@ -332,20 +520,38 @@ bool IntelMausi::setupDMADescriptors()
 {
     IODMACommand::Segment64 seg;
     IOPhysicalSegment rxSegment;
-    mbuf_t spareMbuf[kRxNumSpareMbufs];
     mbuf_t m;
+    IOOptionBits ringOptions = kIODirectionInOut | kIOMemoryPhysicallyContiguous;
     UInt64 offset = 0;
     UInt32 numSegs = 1;
     UInt32 i;
     UInt32 n;
     bool result = false;
 
+    /*
+     * DMA is cache coherent so that the rings may be mapped cacheable.
+     * Descriptor updates are then ordered with intelDescBarrier().
+     */
+    if (!enableCacheableRings)
+        ringOptions |= kIOMapInhibitCache;
+
+    /* Allocate the arrays which keep track of the descriptors of both rings. */
+    txBufArray = (struct intelTxBufferInfo *)IOMalloc(numTxDesc * sizeof(struct intelTxBufferInfo));
+    txRSQueue = (UInt16 *)IOMalloc(numTxDesc * sizeof(UInt16));
+    rxBufArray = (struct intelRxBufferInfo *)IOMalloc(numRxDesc * sizeof(struct intelRxBufferInfo));
+    rxPool = (struct intelRxBufferInfo *)IOMalloc(numRxDesc * sizeof(struct intelRxBufferInfo));
+
+    if (!txBufArray || !txRSQueue || !rxBufArray || !rxPool) {
+        IOLog("[IntelMausi]: Couldn't alloc ring arrays.\n");
+        goto error0;
+    }
+
     /* Create transmitter descriptor array. */
-    txBufDesc = IOBufferMemoryDescriptor::inTaskWithPhysicalMask(kernel_task, (kIODirectionInOut | kIOMemoryPhysicallyContiguous | kIOMapInhibitCache), kTxDescSize, 0xFFFFFFFFFFFFF000ULL);
+    txBufDesc = IOBufferMemoryDescriptor::inTaskWithPhysicalMask(kernel_task, ringOptions, kTxDescSize, 0xFFFFFFFFFFFFF000ULL);
 
     if (!txBufDesc) {
         IOLog("[IntelMausi]: Couldn't alloc txBufDesc.\n");
-        goto done;
+        goto error0;
     }
     if (txBufDesc->prepare() != kIOReturnSuccess) {
         IOLog("[IntelMausi]: txBufDesc->prepare() failed.\n");
@@ -376,22 +582,32 @@ bool IntelMausi::setupDMADescriptors()
     /* Initialize txDescArray. */
     bzero(txDescArray, kTxDescSize);
 
-    for (i = 0; i < kNumTxDesc; i++) {
+    for (i = 0; i < numTxDesc; i++) {
         txBufArray[i].mbuf = NULL;
         txBufArray[i].numDescs = 0;
+        txBufArray[i].numBytes = 0;
         txBufArray[i].pad = 0;
     }
-    txNextDescIndex = txDirtyIndex = txCleanBarrierIndex = 0;
-    txNumFreeDesc = kNumTxDesc;
+    txNextDescIndex = txDirtyIndex = txRSHead = txRSTail = 0;
+    txCtxValid = false;
+    txDescsSinceRS = 0;
+    txDeferredDescs = txDeferredPkts = 0;
+    txNumFreeDesc = numTxDesc;
+    intelTxBqlReset();
     txMbufCursor = IOMbufNaturalMemoryCursor::withSpecification(0x4000, kMaxSegs);
 
     if (!txMbufCursor) {
         IOLog("[IntelMausi]: Couldn't create txMbufCursor.\n");
         goto error4;
     }
+    /* Small packets are copied into bounce buffers. Not having them isn't fatal. */
+    if (txCopyBreak && !setupTxCopyBuffers()) {
+        IOLog("[IntelMausi]: Couldn't create tx bounce buffers. Copybreak disabled.\n");
+        txCopyBreak = 0;
+    }
 
-    /* Create receiver descriptor array. */
-    rxBufDesc = IOBufferMemoryDescriptor::inTaskWithPhysicalMask(kernel_task, (kIODirectionInOut | kIOMemoryPhysicallyContiguous | kIOMapInhibitCache), kRxDescSize, 0xFFFFFFFFFFFFF000ULL);
+    /* Create receiver descriptor array. Packet split descriptors are twice as large. */
+    rxBufDesc = IOBufferMemoryDescriptor::inTaskWithPhysicalMask(kernel_task, ringOptions, (enablePacketSplit) ? kRxPsDescSize : kRxDescSize, 0xFFFFFFFFFFFFF000ULL);
 
     if (!rxBufDesc) {
         IOLog("[IntelMausi]: Couldn't alloc rxBufDesc.\n");
@@ -427,9 +643,9 @@ bool IntelMausi::setupDMADescriptors()
     rxPhyAddr = seg.fIOVMAddr;
 
     /* Initialize rxDescArray. */
-    bzero((void *)rxDescArray, kRxDescSize);
+    bzero((void *)rxDescArray, rxBufDesc->getLength());
 
-    for (i = 0; i < kNumRxDesc; i++) {
+    for (i = 0; i < numRxDesc; i++) {
         rxBufArray[i].mbuf = NULL;
         rxBufArray[i].phyAddr = 0;
     }
@@ -442,8 +658,10 @@ bool IntelMausi::setupDMADescriptors()
         goto error9;
     }
     /* Alloc receive buffers. */
-    for (i = 0; i < kNumRxDesc; i++) {
-        m = allocatePacket(kRxBufferPktSize);
+    rxBufferSize = adapterData.rx_buffer_len;
+
+    for (i = 0; i < numRxDesc; i++) {
+        m = allocatePacket(rxBufferSize);
 
         if (!m) {
             IOLog("[IntelMausi]: Couldn't alloc receive buffer.\n");
@@ -467,23 +685,24 @@ bool IntelMausi::setupDMADescriptors()
         rxDescArray[i].read.buffer_addr = OSSwapHostToLittleInt64(rxSegment.location);
         rxDescArray[i].read.reserved = 0;
     }
-    /* Allocate some spare mbufs and free them in order to increase the buffer pool.
-     * This seems to avoid the replaceOrCopyPacket() errors under heavy load.
-     */
-    for (i = 0; i < kRxNumSpareMbufs; i++)
-        spareMbuf[i] = allocatePacket(kRxBufferPktSize);
-
-    for (i = 0; i < kRxNumSpareMbufs; i++) {
-        if (spareMbuf[i])
-            freePacket(spareMbuf[i]);
+    /* Header buffers for packet split. Not having them isn't fatal either. */
+    if (enablePacketSplit && !setupRxPsBuffers()) {
+        IOLog("[IntelMausi]: Couldn't create rx header buffers. Packet split disabled.\n");
+        enablePacketSplit = false;
     }
+    /* Prefill the pool of pre-mapped buffers used to replace received ones. */
+    rxPoolCount = 0;
+    rxPoolTarget = (numRxDesc < kRxPoolDefSize) ? numRxDesc : kRxPoolDefSize;
+    intelRxPoolRefill();
+    intelRxCopyRefill();
+
     result = true;
 
 done:
     return result;
 
 error10:
-    for (i = 0; i < kNumRxDesc; i++) {
+    for (i = 0; i < numRxDesc; i++) {
         if (rxBufArray[i].mbuf) {
             freePacket(rxBufArray[i].mbuf);
             rxBufArray[i].mbuf = NULL;
@@ -506,6 +725,7 @@ error6:
     rxBufDesc = NULL;
 
 error5:
+    freeTxCopyBuffers();
     RELEASE(txMbufCursor);
 
 error4:
@@ -520,6 +740,9 @@ error2:
 error1:
     txBufDesc->release();
     txBufDesc = NULL;
+
+error0:
+    freeRingArrays();
     goto done;
 }
 
@@ -539,6 +762,7 @@ void IntelMausi::freeDMADescriptors()
         txDescDmaCmd = NULL;
     }
     RELEASE(txMbufCursor);
+    freeTxCopyBuffers();
 
     if (rxBufDesc) {
         rxBufDesc->complete();
@@ -554,14 +778,363 @@ void IntelMausi::freeDMADescriptors()
     }
     RELEASE(rxMbufCursor);
 
-    for (i = 0; i < kNumRxDesc; i++) {
-        if (rxBufArray[i].mbuf) {
-            freePacket(rxBufArray[i].mbuf);
-            rxBufArray[i].mbuf = NULL;
+    if (rxBufArray) {
+        for (i = 0; i < numRxDesc; i++) {
+            if (rxBufArray[i].mbuf) {
+                freePacket(rxBufArray[i].mbuf);
+                rxBufArray[i].mbuf = NULL;
+            }
+        }
+    }
+    if (rxPool) {
+        while (rxPoolCount > 0)
+            freePacket(rxPool[--rxPoolCount].mbuf);
+    }
+    freeRxCopyPool();
+    freeRxPsBuffers();
+    freeRingArrays();
+}
+
+void IntelMausi::freeRingArrays()
+{
+    if (txBufArray) {
+        IOFree(txBufArray, numTxDesc * sizeof(struct intelTxBufferInfo));
+        txBufArray = NULL;
+    }
+    if (txRSQueue) {
+        IOFree(txRSQueue, numTxDesc * sizeof(UInt16));
+        txRSQueue = NULL;
+    }
+    if (rxBufArray) {
+        IOFree(rxBufArray, numRxDesc * sizeof(struct intelRxBufferInfo));
+        rxBufArray = NULL;
+    }
+    if (rxPool) {
+        IOFree(rxPool, numRxDesc * sizeof(struct intelRxBufferInfo));
+        rxPool = NULL;
+    }
+}
+
+/*
+ * Replace all receive buffers after the MTU has changed the buffer size.
+ * Must be called with the receiver stopped. In case new buffers can't be
+ * allocated, the old ones are kept along with their size.
+ */
+bool IntelMausi::intelResizeRxBuffers()
+{
+    IOPhysicalSegment rxSegment;
+    struct intelRxBufferInfo *newArray;
+    UInt32 size = adapterData.rx_buffer_len;
+    UInt32 i;
+    bool result = false;
+
+    newArray = (struct intelRxBufferInfo *)IOMalloc(numRxDesc * sizeof(struct intelRxBufferInfo));
+
+    if (!newArray) {
+        IOLog("[IntelMausi]: Couldn't alloc rx buffer array.\n");
+        goto error;
+    }
+    bzero(newArray, numRxDesc * sizeof(struct intelRxBufferInfo));
+
+    for (i = 0; i < numRxDesc; i++) {
+        newArray[i].mbuf = allocatePacket(size);
+
+        if (!newArray[i].mbuf) {
+            IOLog("[IntelMausi]: Couldn't alloc receive buffer.\n");
+            goto error;
+        }
+        if ((rxMbufCursor->getPhysicalSegments(newArray[i].mbuf, &rxSegment, 1) != 1) || (rxSegment.location & 0x07ff)) {
+            IOLog("[IntelMausi]: getPhysicalSegments() for receive buffer failed.\n");
+            goto error;
+        }
+        newArray[i].phyAddr = rxSegment.location;
+    }
+    /* Release the old buffers and those in the recycle pool. */
+    for (i = 0; i < numRxDesc; i++) {
+        freePacket(rxBufArray[i].mbuf);
+        rxBufArray[i] = newArray[i];
+    }
+    IOFree(newArray, numRxDesc * sizeof(struct intelRxBufferInfo));
+    intelInitRxDescs();
+
+    while (rxPoolCount > 0)
+        freePacket(rxPool[--rxPoolCount].mbuf);
+
+    rxBufferSize = size;
+    intelRxPoolRefill();
+
+    DebugLog("[IntelMausi]: Receive buffer size %u.\n", size);
+    result = true;
+
+done:
+    return result;
+
+error:
+    if (newArray) {
+        for (i = 0; i < numRxDesc; i++) {
+            if (newArray[i].mbuf)
+                freePacket(newArray[i].mbuf);
+        }
+        IOFree(newArray, numRxDesc * sizeof(struct intelRxBufferInfo));
+    }
+    adapterData.rx_buffer_len = rxBufferSize;
+    goto done;
+}
+
+/*
+ * Write the buffer addresses of all receive descriptors in the format
+ * of the current receive mode.
+ */
+void IntelMausi::intelInitRxDescs()
+{
+    UInt32 i;
+
+    if (rxPsPages) {
+        for (i = 0; i < numRxDesc; i++)
+            intelRxPsDescInit(i);
+    } else {
+        for (i = 0; i < numRxDesc; i++) {
+            rxDescArray[i].read.buffer_addr = OSSwapHostToLittleInt64(rxBufArray[i].phyAddr);
+            rxDescArray[i].read.reserved = 0;
         }
     }
 }
 
+/*
+ * Switch the receive ring to or from packet split after the MTU has
+ * changed. The first page of a descriptor is its regular receive buffer,
+ * the others are allocated as required. Must be called with the receiver
+ * stopped. In case of failure the ring is left in single buffer mode.
+ */
+bool IntelMausi::intelSetupRxPsMode()
+{
+    IOPhysicalSegment rxSegment;
+    struct intelRxBufferInfo *page;
+    UInt32 pages = adapterData.rx_ps_pages;
+    UInt32 i;
+    bool result = false;
+
+    if (pages && (!rxPsDescArray || (rxBufferSize != kRxJumboBufferSize)))
+        goto error;
+
+    for (i = 0; rxPsPageArray && (i < kRxPsNumPageBufs); i++) {
+        page = &rxPsPageArray[i];
+
+        /* Entry i holds page (i % (PS_PAGE_BUFFERS - 1)) + 1 of its descriptor. */
+        if (((i % (PS_PAGE_BUFFERS - 1)) + 1) < pages) {
+            if (page->mbuf)
+                continue;
+
+            page->mbuf = allocatePacket(kRxJumboBufferSize);
+
+            if (!page->mbuf) {
+                IOLog("[IntelMausi]: Couldn't alloc receive page buffer.\n");
+                goto error;
+            }
+            if ((rxMbufCursor->getPhysicalSegments(page->mbuf, &rxSegment, 1) != 1) || (rxSegment.location & 0x07ff)) {
+                IOLog("[IntelMausi]: getPhysicalSegments() for receive page buffer failed.\n");
+                freePacket(page->mbuf);
+                page->mbuf = NULL;
+                goto error;
+            }
+            page->phyAddr = rxSegment.location;
+        } else if (page->mbuf) {
+            freePacket(page->mbuf);
+            page->mbuf = NULL;
+            page->phyAddr = 0;
+        }
+    }
+    rxPsPages = pages;
+    intelInitRxDescs();
+
+    DebugLog("[IntelMausi]: Packet split with %u pages.\n", pages);
+    result = true;
+
+done:
+    return result;
+
+error:
+    adapterData.rx_ps_pages = rxPsPages = 0;
+    intelInitRxDescs();
+    goto done;
+}
+
+bool IntelMausi::setupRxPsBuffers()
+{
+    IODMACommand::Segment64 seg;
+    UInt64 offset = 0;
+    UInt32 numSegs = 1;
+    bool result = false;
+
+    rxPsPageArray = (struct intelRxBufferInfo *)IOMalloc(kRxPsNumPageBufs * sizeof(struct intelRxBufferInfo));
+
+    if (!rxPsPageArray) {
+        IOLog("[IntelMausi]: Couldn't alloc rxPsPageArray.\n");
+        goto done;
+    }
+    bzero(rxPsPageArray, kRxPsNumPageBufs * sizeof(struct intelRxBufferInfo));
+
+    /* One header buffer per rx descriptor, located at the same index. */
+    rxPsHdrBufDesc = IOBufferMemoryDescriptor::inTaskWithPhysicalMask(kernel_task, (kIODirectionIn | kIOMemoryPhysicallyContiguous), kRxPsHdrSlabSize, 0xFFFFFFFFFFFFF000ULL);
+
+    if (!rxPsHdrBufDesc) {
+        IOLog("[IntelMausi]: Couldn't alloc rxPsHdrBufDesc.\n");
+        goto error0;
+    }
+    if (rxPsHdrBufDesc->prepare() != kIOReturnSuccess) {
+        IOLog("[IntelMausi]: rxPsHdrBufDesc->prepare() failed.\n");
+        goto error1;
+    }
+    rxPsHdrBuffer = (UInt8 *)rxPsHdrBufDesc->getBytesNoCopy();
+
+    rxPsHdrDmaCmd = IODMACommand::withSpecification(kIODMACommandOutputHost64, 64, 0, IODMACommand::kMapped, 0, 1);
+
+    if (!rxPsHdrDmaCmd) {
+        IOLog("[IntelMausi]: Couldn't alloc rxPsHdrDmaCmd.\n");
+        goto error2;
+    }
+
+    if (rxPsHdrDmaCmd->setMemoryDescriptor(rxPsHdrBufDesc) != kIOReturnSuccess) {
+        IOLog("[IntelMausi]: setMemoryDescriptor() failed.\n");
+        goto error3;
+    }
+
+    if (rxPsHdrDmaCmd->gen64IOVMSegments(&offset, &seg, &numSegs) != kIOReturnSuccess) {
+        IOLog("[IntelMausi]: gen64IOVMSegments() failed.\n");
+        goto error4;
+    }
+    rxPsHdrPhyAddr = seg.fIOVMAddr;
+
+    /* The descriptor ring has been allocated large enough for packet split. */
+    rxPsDescArray = (union e1000_rx_desc_packet_split *)rxDescArray;
+    result = true;
+
+done:
+    return result;
+
+error4:
+    rxPsHdrDmaCmd->clearMemoryDescriptor();
+
+error3:
+    RELEASE(rxPsHdrDmaCmd);
+
+error2:
+    rxPsHdrBufDesc->complete();
+
+error1:
+    rxPsHdrBufDesc->release();
+    rxPsHdrBufDesc = NULL;
+    rxPsHdrBuffer = NULL;
+
+error0:
+    IOFree(rxPsPageArray, kRxPsNumPageBufs * sizeof(struct intelRxBufferInfo));
+    rxPsPageArray = NULL;
+    goto done;
+}
+
+void IntelMausi::freeRxPsBuffers()
+{
+    UInt32 i;
+
+    rxPsDescArray = NULL;
+    adapterData.rx_ps_pages = rxPsPages = 0;
+
+    if (rxPsHdrDmaCmd) {
+        rxPsHdrDmaCmd->clearMemoryDescriptor();
+        rxPsHdrDmaCmd->release();
+        rxPsHdrDmaCmd = NULL;
+    }
+    if (rxPsHdrBufDesc) {
+        rxPsHdrBufDesc->complete();
+        rxPsHdrBufDesc->release();
+        rxPsHdrBufDesc = NULL;
+        rxPsHdrBuffer = NULL;
+        rxPsHdrPhyAddr = 0;
+    }
+    if (rxPsPageArray) {
+        for (i = 0; i < kRxPsNumPageBufs; i++) {
+            if (rxPsPageArray[i].mbuf)
+                freePacket(rxPsPageArray[i].mbuf);
+        }
+        IOFree(rxPsPageArray, kRxPsNumPageBufs * sizeof(struct intelRxBufferInfo));
+        rxPsPageArray = NULL;
+    }
+}
+
+bool IntelMausi::setupTxCopyBuffers()
+{
+    IODMACommand::Segment64 seg;
+    UInt64 offset = 0;
+    UInt32 numSegs = 1;
+    bool result = false;
+
+    /* One bounce buffer per tx descriptor, located at the same index. */
+    txCopyBufDesc = IOBufferMemoryDescriptor::inTaskWithPhysicalMask(kernel_task, (kIODirectionOut | kIOMemoryPhysicallyContiguous), kTxCopySlabSize, 0xFFFFFFFFFFFFF000ULL);
+
+    if (!txCopyBufDesc) {
+        IOLog("[IntelMausi]: Couldn't alloc txCopyBufDesc.\n");
+        goto done;
+    }
+    if (txCopyBufDesc->prepare() != kIOReturnSuccess) {
+        IOLog("[IntelMausi]: txCopyBufDesc->prepare() failed.\n");
+        goto error1;
+    }
+    txCopyBuffer = (UInt8 *)txCopyBufDesc->getBytesNoCopy();
+
+    txCopyDmaCmd = IODMACommand::withSpecification(kIODMACommandOutputHost64, 64, 0, IODMACommand::kMapped, 0, 1);
+
+    if (!txCopyDmaCmd) {
+        IOLog("[IntelMausi]: Couldn't alloc txCopyDmaCmd.\n");
+        goto error2;
+    }
+
+    if (txCopyDmaCmd->setMemoryDescriptor(txCopyBufDesc) != kIOReturnSuccess) {
+        IOLog("[IntelMausi]: setMemoryDescriptor() failed.\n");
+        goto error3;
+    }
+
+    if (txCopyDmaCmd->gen64IOVMSegments(&offset, &seg, &numSegs) != kIOReturnSuccess) {
+        IOLog("[IntelMausi]: gen64IOVMSegments() failed.\n");
+        goto error4;
+    }
+    txCopyPhyAddr = seg.fIOVMAddr;
+    result = true;
+
+done:
+    return result;
+
+error4:
+    txCopyDmaCmd->clearMemoryDescriptor();
+
+error3:
+    RELEASE(txCopyDmaCmd);
+
+error2:
+    txCopyBufDesc->complete();
+
+error1:
+    txCopyBufDesc->release();
+    txCopyBufDesc = NULL;
+    txCopyBuffer = NULL;
+    goto done;
+}
+
+void IntelMausi::freeTxCopyBuffers()
+{
+    if (txCopyDmaCmd) {
+        txCopyDmaCmd->clearMemoryDescriptor();
+        txCopyDmaCmd->release();
+        txCopyDmaCmd = NULL;
+    }
+    if (txCopyBufDesc) {
+        txCopyBufDesc->complete();
+        txCopyBufDesc->release();
+        txCopyBufDesc = NULL;
+        txCopyBuffer = NULL;
+        txCopyPhyAddr = 0;
+    }
+}
+
 void IntelMausi::clearDescriptors()
 {
     mbuf_t m;
@@ -570,29 +1143,32 @@ void IntelMausi::clearDescriptors()
     DebugLog("[IntelMausi]: clearDescriptors() ===>\n");
 
     /* First cleanup the tx descriptor ring. */
-    for (i = 0; i < kNumTxDesc; i++) {
+    for (i = 0; i < numTxDesc; i++) {
         m = txBufArray[i].mbuf;
 
         if (m) {
             freePacket(m);
             txBufArray[i].mbuf = NULL;
-            txBufArray[i].numDescs = 0;
         }
+        txBufArray[i].numDescs = 0;
     }
-    txNextDescIndex = txDirtyIndex = txCleanBarrierIndex = 0;
-    txNumFreeDesc = kNumTxDesc;
+    txNextDescIndex = txDirtyIndex = txRSHead = txRSTail = 0;
+    txCtxValid = false;
+    txDescsSinceRS = 0;
+    txDeferredDescs = txDeferredPkts = 0;
+    txNumFreeDesc = numTxDesc;
+    intelTxBqlReset();
 
     /* On descriptor writeback the buffer addresses are overwritten so that
      * we must restore them in order to make sure that we leave the ring in
      * a usable state.
      */
-    if (rxDescArray) {
-        for (i = 0; i < kNumRxDesc; i++) {
-            rxDescArray[i].read.buffer_addr = OSSwapHostToLittleInt64(rxBufArray[i].phyAddr);
-            rxDescArray[i].read.reserved = 0;
-        }
-    }
+    if (rxDescArray)
+        intelInitRxDescs();
+
     rxCleanedCount = rxNextDescIndex = 0;
+    rxPsDiscard = false;
+    rxDiscard = false;
 
     /* Free packet fragments which haven't been upstreamed yet.  */
     discardPacketFragment();
@@ -0,0 +1,83 @@
+/* Bench.cpp -- Host side benchmarks of the IntelMausi ring code.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Usage: Bench [suite ...]
+ * Without arguments all suites are run.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "Bench.h"
+
+volatile UInt64 benchSink;
+
+struct BenchSuite {
+    const char *name;
+    void (*run)();
+};
+
+static const struct BenchSuite suites[] = {
+    { "tx-setup", benchTxSetup },
+    { "tx-copy", benchTxCopy },
+    { "rx-split", benchRxSplit },
+    { "rx-harvest", benchRxHarvest },
+    { "ring-cache", benchRingCache },
+};
+
+#define kNumSuites (sizeof(suites) / sizeof(suites[0]))
+
+UInt64 benchNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((UInt64)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+void benchReport(const char *suite, const char *name, UInt64 ns, UInt64 count)
+{
+    double nsPerItem = (double)ns / count;
+
+    printf("%-12s %-32s %10.2f ns %12.0f /s\n", suite, name, nsPerItem, 1e9 / nsPerItem);
+}
+
+int main(int argc, const char *argv[])
+{
+    UInt32 i;
+    int j;
+    bool found;
+
+    for (j = 1; j < argc; j++) {
+        found = false;
+
+        for (i = 0; i < kNumSuites; i++)
+            found |= !strcmp(argv[j], suites[i].name);
+
+        if (!found) {
+            fprintf(stderr, "Bench: unknown suite %s\n", argv[j]);
+            return 1;
+        }
+    }
+    for (i = 0; i < kNumSuites; i++) {
+        found = (argc == 1);
+
+        for (j = 1; j < argc; j++)
+            found |= !strcmp(argv[j], suites[i].name);
+
+        if (found)
+            suites[i].run();
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+/* Bench.h -- Host side benchmarks of the IntelMausi ring code.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Each suite measures one code path of the driver on rings and buffers
+ * allocated on the heap. Parts which depend on the kernel (DMA mapping,
+ * MMIO, interrupts) can't be reproduced here and are noted by the suites.
+ */
+
+#ifndef Bench_h
+#define Bench_h
+
+#include "HostStubs.h"
+#include "IntelMausiRing.h"
+
+/* Monotonic time in nanoseconds. */
+UInt64 benchNow();
+
+/* Print ns per item and items per second of a measurement. */
+void benchReport(const char *suite, const char *name, UInt64 ns, UInt64 count);
+
+/* Keeps the compiler from discarding the results of a measurement. */
+extern volatile UInt64 benchSink;
+
+/* The suites */
+void benchTxSetup();
+void benchTxCopy();
+void benchRxSplit();
+void benchRxHarvest();
+void benchRingCache();
+
+#endif /* Bench_h */
@@ -0,0 +1,172 @@
+/* BenchRingCache.cpp -- Descriptor accesses of a cacheable ring.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Measures the descriptor work of txInterrupt() (DD check of the RS
+ * descriptors, cleanup of the buffer info) and of the rx harvest with
+ * enableCacheableRings set, per descriptor. "hot" leaves the descriptors in
+ * the cache, "after DMA" flushes them on x86 after the simulated write-back
+ * the way a coherent DMA write invalidates them.
+ *
+ * The default uncached mapping (kIOMapInhibitCache) has no user space
+ * equivalent, so the saving against it can't be measured here. In the
+ * kernel compare the intrDurationUs histogram with enableCacheableRings on
+ * and off: interruptOccurred() runs txInterrupt() and, unless the ring is
+ * being polled, rxInterrupt().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+
+#define kRingSize       256
+#define kBufSize        2048
+#define kRSInterval     4
+#define kLaps           20000
+
+struct TxBufInfo {
+    mbuf_t mbuf;
+    UInt32 numDescs;
+    UInt32 numBytes;
+};
+
+static inline void flushLine(const void *addr)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_clflush(addr);
+#else
+    (void)addr;
+#endif
+}
+
+static void benchTxReclaim(bool flush)
+{
+    struct e1000_data_desc *descs = (struct e1000_data_desc *)calloc(kRingSize, sizeof(struct e1000_data_desc));
+    struct TxBufInfo *bufs = (struct TxBufInfo *)calloc(kRingSize, sizeof(struct TxBufInfo));
+    UInt16 rsQueue[kRingSize];
+    UInt64 elapsed = 0;
+    UInt64 start;
+    UInt32 rsHead;
+    UInt32 rsTail;
+    UInt32 dirty;
+    UInt32 endIndex;
+    UInt32 cleaned;
+    UInt32 lap;
+    UInt32 i;
+
+    for (lap = 0; lap < kLaps; lap++) {
+        /* Every descriptor holds a packet, every kRSInterval-th reports status. */
+        rsTail = 0;
+
+        for (i = 0; i < kRingSize; i++) {
+            bufs[i].mbuf = (mbuf_t)(uintptr_t)(i + 1);
+            bufs[i].numDescs = 1;
+            bufs[i].numBytes = 60 + i;
+            descs[i].upper.data = 0;
+
+            if ((i % kRSInterval) == (kRSInterval - 1)) {
+                descs[i].upper.data = E1000_TXD_STAT_DD;
+                rsQueue[rsTail++] = i;
+            }
+        }
+        if (flush) {
+            for (i = 0; i < kRingSize; i += 4)
+                flushLine(&descs[i]);
+        }
+        start = benchNow();
+        rsHead = 0;
+        dirty = 0;
+        cleaned = 0;
+
+        while (rsHead != rsTail) {
+            if (!(*(volatile UInt32 *)&descs[rsQueue[rsHead]].upper.data & E1000_TXD_STAT_DD))
+                break;
+
+            endIndex = (rsQueue[rsHead] + 1) & (kRingSize - 1);
+
+            do {
+                if (bufs[dirty].numDescs) {
+                    benchSink += (uintptr_t)bufs[dirty].mbuf + bufs[dirty].numBytes;
+                    bufs[dirty].mbuf = NULL;
+                    cleaned += bufs[dirty].numDescs;
+                    bufs[dirty].numDescs = 0;
+                }
+                dirty = (dirty + 1) & (kRingSize - 1);
+            } while (dirty != endIndex);
+
+            rsHead++;
+        }
+        elapsed += benchNow() - start;
+        benchSink += cleaned;
+    }
+    benchReport("ring-cache", flush ? "txInterrupt after DMA" : "txInterrupt hot", elapsed, (UInt64)kLaps * kRingSize);
+
+    free(bufs);
+    free(descs);
+}
+
+static void benchRxDescs(bool flush)
+{
+    union e1000_rx_desc_extended *descs = (union e1000_rx_desc_extended *)calloc(kRingSize, sizeof(union e1000_rx_desc_extended));
+    struct intelRxBufferInfo *bufs = (struct intelRxBufferInfo *)calloc(kRingSize, sizeof(struct intelRxBufferInfo));
+    struct intelRxBatchEntry batch[32];
+    UInt64 elapsed = 0;
+    UInt64 start;
+    UInt32 index;
+    UInt32 numDescs;
+    UInt32 lap;
+    UInt32 i;
+
+    for (i = 0; i < kRingSize; i++) {
+        bufs[i].mbuf = hostMbufAlloc(kBufSize);
+        bufs[i].phyAddr = (IOPhysicalAddress64)(uintptr_t)mbuf_data(bufs[i].mbuf);
+    }
+    for (lap = 0; lap < kLaps; lap++) {
+        for (i = 0; i < kRingSize; i++) {
+            descs[i].wb.upper.status_error = E1000_RXD_STAT_DD | E1000_RXD_STAT_EOP;
+            descs[i].wb.upper.length = 60 + i;
+
+            if (flush)
+                flushLine(&descs[i]);
+        }
+        start = benchNow();
+        index = 0;
+
+        do {
+            numDescs = intelRxHarvestDescs(descs, bufs, index, kRingSize - 1, batch, 32);
+
+            for (i = 0; i < numDescs; i++) {
+                benchSink += batch[i].length;
+                descs[index].read.buffer_addr = bufs[index].phyAddr;
+                descs[index].read.reserved = 0;
+                index = (index + 1) & (kRingSize - 1);
+            }
+        } while (numDescs && index);
+
+        elapsed += benchNow() - start;
+    }
+    benchReport("ring-cache", flush ? "rxInterrupt descs after DMA" : "rxInterrupt descs hot", elapsed, (UInt64)kLaps * kRingSize);
+
+    for (i = 0; i < kRingSize; i++)
+        hostMbufFree(bufs[i].mbuf);
+
+    free(bufs);
+    free(descs);
+}
+
+void benchRingCache()
+{
+    benchTxReclaim(false);
+    benchTxReclaim(true);
+    benchRxDescs(false);
+    benchRxDescs(true);
+}
@@ -0,0 +1,231 @@
+/* BenchRxSplit.cpp -- Packet split versus single buffer receive.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * A heap ring of extended descriptors with one jumbo buffer each is compared
+ * with a ring of packet split descriptors with a header buffer and three 4K
+ * pages, for small, standard and jumbo frames. The driver side follows
+ * rxInterrupt() and intelRxPsPacket(): small packets are copied (rxCopyBreak
+ * 256), large ones are passed on and their buffers replaced from a pool,
+ * then the descriptor is reinitialized. The write-back of the NIC is
+ * simulated in the same loop; its cost is reported on its own so that it
+ * can be subtracted.
+ *
+ * Buffers are recycled from a preallocated pool. In the driver a jumbo
+ * buffer is a 9K or 16K mbuf cluster and a page a 4K cluster, and the
+ * allocation cost of the two differs in the mbuf allocator, which can only
+ * be measured in the kernel. The same applies to the DMA transfer of the
+ * headers into the separate header slab.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+
+#define kRingSize       256
+#define kIterations     2000000
+#define kRxCopyBreak    256
+#define kJumboBufSize   16384
+#define kPageSize       4096
+#define kHdrSize        256
+#define kHdrLen         54
+
+struct BufferPool {
+    UInt8 **bufs;
+    UInt32 count;
+};
+
+static void poolInit(struct BufferPool *pool, UInt32 count, size_t size)
+{
+    UInt32 i;
+
+    pool->bufs = (UInt8 **)calloc(count, sizeof(UInt8 *));
+    pool->count = count;
+
+    /* Touch the buffers so that page faults don't end up in the measurement. */
+    for (i = 0; i < count; i++) {
+        pool->bufs[i] = (UInt8 *)malloc(size);
+        memset(pool->bufs[i], 0, size);
+    }
+}
+
+static void poolFree(struct BufferPool *pool)
+{
+    UInt32 i;
+
+    for (i = 0; i < pool->count; i++)
+        free(pool->bufs[i]);
+
+    free(pool->bufs);
+}
+
+/* The stack consumes a delivered buffer and the driver gets it back later. */
+static inline UInt8 *poolSwap(struct BufferPool *pool, UInt32 *next, UInt8 *buf)
+{
+    UInt8 *result = pool->bufs[*next];
+
+    benchSink += buf[0];
+    pool->bufs[*next] = buf;
+    *next = (*next + 1) % pool->count;
+
+    return result;
+}
+
+static UInt64 runSingle(UInt32 pktLen, bool driver)
+{
+    union e1000_rx_desc_extended *ring = (union e1000_rx_desc_extended *)calloc(kRingSize, sizeof(*ring));
+    struct BufferPool bufs;
+    struct BufferPool spares;
+    UInt8 small[kRxCopyBreak];
+    UInt64 upper;
+    UInt64 start;
+    UInt32 spareIndex = 0;
+    UInt32 index;
+    UInt32 len;
+    UInt32 i;
+
+    poolInit(&bufs, kRingSize, kJumboBufSize);
+    poolInit(&spares, kRingSize, kJumboBufSize);
+
+    start = benchNow();
+
+    for (i = 0; i < kIterations; i++) {
+        index = i & (kRingSize - 1);
+
+        /* The NIC writes the frame and the write-back. */
+        memset(bufs.bufs[index], 0x5a, kHdrLen);
+        ring[index].wb.upper.status_error = E1000_RXD_STAT_DD | E1000_RXD_STAT_EOP;
+        ring[index].wb.upper.length = pktLen;
+
+        if (!driver)
+            continue;
+
+        upper = *(volatile UInt64 *)&ring[index].wb.upper;
+
+        if (!(upper & E1000_RXD_STAT_DD))
+            break;
+
+        len = (UInt16)(upper >> 32);
+
+        if (len <= kRxCopyBreak) {
+            memcpy(small, bufs.bufs[index], len);
+            benchSink += small[0];
+        } else {
+            bufs.bufs[index] = poolSwap(&spares, &spareIndex, bufs.bufs[index]);
+        }
+        ring[index].read.buffer_addr = (UInt64)(uintptr_t)bufs.bufs[index];
+        ring[index].read.reserved = 0;
+    }
+    start = benchNow() - start;
+
+    poolFree(&spares);
+    poolFree(&bufs);
+    free(ring);
+
+    return start;
+}
+
+static UInt64 runSplit(UInt32 pktLen, bool driver)
+{
+    union e1000_rx_desc_packet_split *ring = (union e1000_rx_desc_packet_split *)calloc(kRingSize, sizeof(*ring));
+    UInt8 *hdrSlab = (UInt8 *)calloc(kRingSize, kHdrSize);
+    struct BufferPool pages;
+    struct BufferPool spares;
+    UInt8 small[kHdrSize];
+    UInt8 *chain[PS_PAGE_BUFFERS];
+    UInt64 start;
+    UInt32 payloadLen = pktLen - kHdrLen;
+    UInt32 spareIndex = 0;
+    UInt32 status;
+    UInt32 hdrLen;
+    UInt32 index;
+    UInt32 len;
+    UInt32 i;
+    UInt32 j;
+
+    poolInit(&pages, kRingSize * PS_PAGE_BUFFERS, kPageSize);
+    poolInit(&spares, kRingSize * PS_PAGE_BUFFERS, kPageSize);
+
+    start = benchNow();
+
+    for (i = 0; i < kIterations; i++) {
+        index = i & (kRingSize - 1);
+
+        /* The NIC splits the frame into the header buffer and the pages. */
+        memset(hdrSlab + index * kHdrSize, 0x5a, kHdrLen);
+        ring[index].wb.middle.status_error = E1000_RXD_STAT_DD | E1000_RXD_STAT_EOP;
+        ring[index].wb.middle.length0 = kHdrLen;
+
+        for (j = 0; j < PS_PAGE_BUFFERS; j++) {
+            len = (payloadLen > j * kPageSize) ? (payloadLen - j * kPageSize) : 0;
+            ring[index].wb.upper.length[j] = (len > kPageSize) ? kPageSize : len;
+        }
+        if (!driver)
+            continue;
+
+        status = *(volatile UInt32 *)&ring[index].wb.middle.status_error;
+
+        if (!(status & E1000_RXD_STAT_DD))
+            break;
+
+        hdrLen = ring[index].wb.middle.length0;
+        memcpy(small, hdrSlab + index * kHdrSize, hdrLen);
+        len = (UInt16)ring[index].wb.upper.length[0];
+
+        if (len && (len <= kRxCopyBreak) && ((hdrLen + len) <= kHdrSize)) {
+            memcpy(small + hdrLen, pages.bufs[index * PS_PAGE_BUFFERS], len);
+        } else {
+            for (j = 0; (j < PS_PAGE_BUFFERS) && ring[index].wb.upper.length[j]; j++) {
+                chain[j] = pages.bufs[index * PS_PAGE_BUFFERS + j];
+                pages.bufs[index * PS_PAGE_BUFFERS + j] = poolSwap(&spares, &spareIndex, chain[j]);
+            }
+        }
+        benchSink += small[0];
+
+        ring[index].read.buffer_addr[0] = (UInt64)(uintptr_t)(hdrSlab + index * kHdrSize);
+
+        for (j = 0; j < PS_PAGE_BUFFERS; j++)
+            ring[index].read.buffer_addr[j + 1] = (UInt64)(uintptr_t)pages.bufs[index * PS_PAGE_BUFFERS + j];
+    }
+    start = benchNow() - start;
+
+    poolFree(&spares);
+    poolFree(&pages);
+    free(hdrSlab);
+    free(ring);
+
+    return start;
+}
+
+void benchRxSplit()
+{
+    static const UInt32 sizes[] = { 64, 1514, 4096, 9014 };
+    char name[64];
+    UInt64 hw;
+    UInt32 c;
+
+    for (c = 0; c < sizeof(sizes) / sizeof(sizes[0]); c++) {
+        hw = runSingle(sizes[c], false);
+        snprintf(name, sizeof(name), "%u bytes, single, write-back", sizes[c]);
+        benchReport("rx-split", name, hw, kIterations);
+
+        snprintf(name, sizeof(name), "%u bytes, single buffer", sizes[c]);
+        benchReport("rx-split", name, runSingle(sizes[c], true), kIterations);
+
+        hw = runSplit(sizes[c], false);
+        snprintf(name, sizeof(name), "%u bytes, split, write-back", sizes[c]);
+        benchReport("rx-split", name, hw, kIterations);
+
+        snprintf(name, sizeof(name), "%u bytes, packet split", sizes[c]);
+        benchReport("rx-split", name, runSplit(sizes[c], true), kIterations);
+    }
+}
@@ -0,0 +1,104 @@
+/* BenchTxCopy.cpp -- Tx copybreak versus mapping small packets.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The copy path copies the packet into the bounce buffer of its descriptor
+ * like intelCopyTxPacket() and writes a single data descriptor. The map path
+ * walks the mbuf chain into segments and writes one descriptor per segment
+ * like intelMapTxSegments() and intelFillTxDescs().
+ *
+ * In user space the map path only pays for the chain walk. The kernel's
+ * IOMbufNaturalMemoryCursor additionally translates every mbuf to a
+ * physical address through the pmap, and the mbuf stays attached to the
+ * ring until txInterrupt() frees it, whereas the copy path frees it right
+ * away while it is still in the cache. The map path numbers are therefore
+ * a lower bound of its cost in the driver.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+#include "TestPackets.h"
+
+#define kRingSize       256
+#define kTxCopyBufSize  256
+#define kMaxSegs        40
+#define kIterations     4000000
+
+void benchTxCopy()
+{
+    static const struct {
+        UInt32 payloadLen;
+        size_t headLen;         /* length of the first mbuf or 0 for one mbuf */
+    } cases[] = {
+        { 18, 0 },
+        { 18, ETH_HLEN + sizeof(struct ip) + sizeof(struct udphdr) },
+        { 100, 0 },
+        { 100, ETH_HLEN + sizeof(struct ip) + sizeof(struct udphdr) },
+        { 214, 0 },
+        { 214, ETH_HLEN + sizeof(struct ip) + sizeof(struct udphdr) },
+    };
+    struct e1000_data_desc *ring = (struct e1000_data_desc *)calloc(kRingSize, sizeof(struct e1000_data_desc));
+    UInt8 *slab = (UInt8 *)calloc(kRingSize, kTxCopyBufSize);
+    IOPhysicalSegment segments[kMaxSegs];
+    struct intelTxDescSetup setup;
+    char name[64];
+    UInt64 start;
+    UInt32 numSegs;
+    UInt32 index;
+    UInt32 len;
+    UInt32 c;
+    UInt32 i;
+    UInt32 j;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.opts = (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS);
+
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        struct PacketSpec spec = { false, false, 0, 0, 0, cases[c].payloadLen, true };
+        std::vector<UInt8> pkt = buildPacket(&spec);
+        mbuf_t m = hostMbufChain(&pkt[0], pkt.size(), &cases[c].headLen, cases[c].headLen ? 1 : 0);
+
+        len = (UInt32)mbuf_pkthdr_len(m);
+        index = 0;
+        start = benchNow();
+
+        for (i = 0; i < kIterations; i++) {
+            mbuf_copydata(m, 0, len, slab + index * kTxCopyBufSize);
+            segments[0].location = (IOPhysicalAddress)(uintptr_t)(slab + index * kTxCopyBufSize);
+            segments[0].length = len;
+            intelTxWriteData(&ring[index], &setup, &segments[0], setup.opts);
+            index = (index + 1) & (kRingSize - 1);
+        }
+        snprintf(name, sizeof(name), "%u bytes, %s, copy", len, cases[c].headLen ? "2 mbufs" : "1 mbuf");
+        benchReport("tx-copy", name, benchNow() - start, kIterations);
+
+        index = 0;
+        start = benchNow();
+
+        for (i = 0; i < kIterations; i++) {
+            numSegs = hostMbufSegments(m, segments, kMaxSegs);
+
+            for (j = 0; j < numSegs; j++) {
+                intelTxWriteData(&ring[index], &setup, &segments[j], (j == (numSegs - 1)) ? setup.opts : 0);
+                index = (index + 1) & (kRingSize - 1);
+            }
+        }
+        snprintf(name, sizeof(name), "%u bytes, %s, map", len, cases[c].headLen ? "2 mbufs" : "1 mbuf");
+        benchReport("tx-copy", name, benchNow() - start, kIterations);
+
+        benchSink += ring[0].lower.data + slab[0];
+        hostMbufFree(m);
+    }
+    free(slab);
+    free(ring);
+}
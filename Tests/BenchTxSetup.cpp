@@ -0,0 +1,147 @@
+/* BenchTxSetup.cpp -- Per packet cost of the tx descriptor setup.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * For each checksum offload class a small packet gets its context set up and
+ * its context and data descriptor written into a ring on the heap. The
+ * specialized setup functions of txSetupFuncs are compared with a generic
+ * version reading the command bits from txOffloadInfo at runtime, which is
+ * what the driver did before. Mapping the mbuf for DMA is kernel only and
+ * not part of the measurement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+#include "TestPackets.h"
+
+#define kRingSize       256
+#define kIterations     4000000
+
+struct BenchRing {
+    struct e1000_data_desc descs[kRingSize];
+    UInt32 next;
+};
+
+/* The former table driven setup of all classes. */
+static __attribute__((noinline)) UInt32 setupGeneric(mbuf_t m, const struct intelTxOffloadInfo *info, struct intelTxDescSetup *setup, UInt32 *l3Offset)
+{
+    UInt32 l4Offset;
+    UInt32 result = kTxSetupDone;
+
+    if (!info->cmdLen)
+        goto done;
+
+    if (!intelTxParseHeaders(m, info, l3Offset, &l4Offset)) {
+        result = kTxSetupUnsupported;
+        goto done;
+    }
+    setup->cmd = (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D);
+    setup->cmdLen = info->cmdLen;
+    setup->word2 = info->word2;
+
+    if (info->etherType == ETH_P_IP)
+        setup->ipConfig = (((l4Offset - 1) << 16) | ((*l3Offset + offsetof(struct ip, ip_sum)) << 8) | *l3Offset);
+    else
+        setup->ipConfig = *l3Offset;
+
+    if (info->l4Proto)
+        setup->tcpConfig = (((l4Offset + info->l4CSumOffset) << 8) | l4Offset);
+    else
+        setup->tcpConfig = 0;
+
+done:
+    return result;
+}
+
+static inline void ringPut(struct BenchRing *ring, struct intelTxDescSetup *setup, const IOPhysicalSegment *segment)
+{
+    if (setup->cmdLen) {
+        intelTxWriteContext((struct e1000_context_desc *)&ring->descs[ring->next], setup);
+        ring->next = (ring->next + 1) & (kRingSize - 1);
+    }
+    intelTxWriteData(&ring->descs[ring->next], setup, segment, setup->opts);
+    ring->next = (ring->next + 1) & (kRingSize - 1);
+}
+
+static inline void setupInit(struct intelTxDescSetup *setup)
+{
+    setup->cmd = 0;
+    setup->opts = (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS);
+    setup->word2 = 0;
+    setup->cmdLen = 0;
+    setup->mss = 0;
+    setup->numDescs = 0;
+    setup->tso = false;
+}
+
+void benchTxSetup()
+{
+    static const struct {
+        const char *name;
+        UInt32 offloadFlags;
+        struct PacketSpec spec;
+    } cases[] = {
+        { "none", 0, { false, false, 0, 0, 0, 64, false } },
+        { "TCPv4", kChecksumTCP | kChecksumIP, { false, false, 0, 0, 12, 64, false } },
+        { "UDPv4", kChecksumUDP | kChecksumIP, { false, false, 0, 0, 0, 64, true } },
+        { "IPv4", kChecksumIP, { false, false, 0, 0, 0, 64, true } },
+        { "TCPv6", kChecksumTCPIPv6, { true, false, 0, 0, 12, 64, false } },
+        { "UDPv6", kChecksumUDPIPv6, { true, false, 0, 0, 0, 64, true } },
+    };
+    struct BenchRing *ring = (struct BenchRing *)calloc(1, sizeof(struct BenchRing));
+    struct intelTxDescSetup setup;
+    IOPhysicalSegment segment;
+    char name[64];
+    volatile UInt32 offloadFlags;
+    UInt64 start;
+    UInt32 offloadClass;
+    UInt32 l3Offset;
+    UInt32 c;
+    UInt32 i;
+
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        std::vector<UInt8> pkt = buildPacket(&cases[c].spec);
+        mbuf_t m = hostMbufChain(&pkt[0], pkt.size(), NULL, 0);
+
+        hostMbufSegments(m, &segment, 1);
+        offloadFlags = cases[c].offloadFlags;
+
+        start = benchNow();
+
+        for (i = 0; i < kIterations; i++) {
+            setupInit(&setup);
+            offloadClass = intelTxOffloadClass(offloadFlags);
+
+            if (txSetupFuncs[offloadClass](m, &setup, &l3Offset) == kTxSetupDone)
+                ringPut(ring, &setup, &segment);
+        }
+        snprintf(name, sizeof(name), "%s specialized", cases[c].name);
+        benchReport("tx-setup", name, benchNow() - start, kIterations);
+
+        start = benchNow();
+
+        for (i = 0; i < kIterations; i++) {
+            setupInit(&setup);
+            offloadClass = intelTxOffloadClass(offloadFlags);
+
+            if (setupGeneric(m, &txOffloadInfo[offloadClass], &setup, &l3Offset) == kTxSetupDone)
+                ringPut(ring, &setup, &segment);
+        }
+        snprintf(name, sizeof(name), "%s generic", cases[c].name);
+        benchReport("tx-setup", name, benchNow() - start, kIterations);
+
+        benchSink += ring->descs[0].lower.data;
+        hostMbufFree(m);
+    }
+    free(ring);
+}
@@ -0,0 +1,174 @@
+/* HostStubs.cpp -- User space replacement of the mbuf KPI for the tests.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "HostStubs.h"
+
+mbuf_t hostMbufAlloc(size_t size)
+{
+    mbuf_t m = (mbuf_t)calloc(1, sizeof(struct HostMbuf));
+
+    m->buffer = (UInt8 *)calloc(1, size);
+    m->data = m->buffer;
+    m->size = size;
+
+    return m;
+}
+
+/* Build a chain holding len bytes of data split into mbufs of chunks[i] bytes. */
+mbuf_t hostMbufChain(const UInt8 *data, size_t len, const size_t *chunks, UInt32 numChunks)
+{
+    mbuf_t head = NULL;
+    mbuf_t tail = NULL;
+    mbuf_t m;
+    size_t offset = 0;
+    size_t n;
+    UInt32 i = 0;
+
+    while (offset < len) {
+        n = (i < numChunks) ? chunks[i++] : (len - offset);
+
+        if (n > (len - offset))
+            n = len - offset;
+
+        m = hostMbufAlloc(n);
+        memcpy(m->data, data + offset, n);
+        m->len = n;
+        offset += n;
+
+        if (tail)
+            tail->next = m;
+        else
+            head = m;
+
+        tail = m;
+    }
+    head->pktLen = len;
+
+    return head;
+}
+
+void hostMbufFree(mbuf_t m)
+{
+    mbuf_t next;
+
+    while (m) {
+        next = m->next;
+        free(m->buffer);
+        free(m);
+        m = next;
+    }
+}
+
+/* Stands in for IOMbufNaturalMemoryCursor::getPhysicalSegmentsWithCoalesce(). */
+UInt32 hostMbufSegments(mbuf_t m, IOPhysicalSegment *segments, UInt32 maxSegs)
+{
+    UInt32 n = 0;
+
+    for (; m; m = m->next) {
+        if (!m->len)
+            continue;
+
+        if (n == maxSegs)
+            return 0;
+
+        segments[n].location = (IOPhysicalAddress)(uintptr_t)m->data;
+        segments[n].length = (IOPhysicalLength)m->len;
+        n++;
+    }
+    return n;
+}
+
+size_t mbuf_len(mbuf_t m)
+{
+    return m->len;
+}
+
+void *mbuf_data(mbuf_t m)
+{
+    return m->data;
+}
+
+size_t mbuf_pkthdr_len(mbuf_t m)
+{
+    return m->pktLen;
+}
+
+errno_t mbuf_copydata(mbuf_t m, size_t offset, size_t len, void *out)
+{
+    UInt8 *dst = (UInt8 *)out;
+    size_t n;
+
+    for (; m && (offset >= m->len); m = m->next)
+        offset -= m->len;
+
+    for (; m && len; m = m->next) {
+        n = m->len - offset;
+
+        if (n > len)
+            n = len;
+
+        memcpy(dst, m->data + offset, n);
+        dst += n;
+        len -= n;
+        offset = 0;
+    }
+    return len ? EINVAL : 0;
+}
+
+/* Like the kernel's version the chain is freed on failure. */
+errno_t mbuf_pullup(mbuf_t *m, size_t len)
+{
+    mbuf_t head = *m;
+    mbuf_t next;
+    UInt8 *buffer;
+    size_t n;
+
+    if (len > head->pktLen) {
+        hostMbufFree(head);
+        *m = NULL;
+        return EINVAL;
+    }
+    if (len <= head->len)
+        return 0;
+
+    buffer = (UInt8 *)calloc(1, len);
+    memcpy(buffer, head->data, head->len);
+    n = head->len;
+
+    while (n < len) {
+        next = head->next;
+
+        if ((len - n) >= next->len) {
+            memcpy(buffer + n, next->data, next->len);
+            n += next->len;
+            head->next = next->next;
+            free(next->buffer);
+            free(next);
+        } else {
+            memcpy(buffer + n, next->data, len - n);
+            next->data += (len - n);
+            next->len -= (len - n);
+            n = len;
+        }
+    }
+    free(head->buffer);
+    head->buffer = buffer;
+    head->data = buffer;
+    head->len = len;
+    head->size = len;
+
+    return 0;
+}
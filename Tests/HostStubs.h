@@ -0,0 +1,134 @@
+/* HostStubs.h -- Kernel types and KPIs needed to build the ring helpers
+ * of IntelMausi in user space.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Only the small subset of the mbuf KPI used by IntelMausiRing.h is
+ * provided. An mbuf is a plain heap buffer and its "physical" address is
+ * its virtual address.
+ */
+
+#ifndef HostStubs_h
+#define HostStubs_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+
+typedef uint8_t UInt8;
+typedef uint16_t UInt16;
+typedef uint32_t UInt32;
+typedef uint64_t UInt64;
+typedef int8_t SInt8;
+typedef int16_t SInt16;
+typedef int32_t SInt32;
+typedef int64_t SInt64;
+
+typedef UInt64 IOPhysicalAddress;
+typedef UInt64 IOPhysicalAddress64;
+typedef UInt32 IOPhysicalLength;
+
+struct IOPhysicalSegment {
+    IOPhysicalAddress location;
+    IOPhysicalLength length;
+};
+
+typedef int errno_t;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define OSSwapHostToLittleInt16(x) ((UInt16)(x))
+#define OSSwapHostToLittleInt32(x) ((UInt32)(x))
+#define OSSwapHostToLittleInt64(x) ((UInt64)(x))
+#define OSSwapLittleToHostInt16(x) ((UInt16)(x))
+#define OSSwapLittleToHostInt32(x) ((UInt32)(x))
+#define OSSwapLittleToHostInt64(x) ((UInt64)(x))
+#else
+#error "The host tests expect a little endian host."
+#endif
+
+/* Types and macros required by hw.h. */
+#define u8      UInt8
+#define u16     UInt16
+#define u32     UInt32
+#define u64     UInt64
+#define s32     SInt32
+#define s64     SInt64
+#define __le16  SInt16
+#define __le32  SInt32
+#define __le64  SInt64
+#define __iomem
+#define BIT(nr) (1UL << (nr))
+
+#ifndef ETH_ALEN
+#define ETH_ALEN        6
+#endif
+#ifndef ETH_HLEN
+#define ETH_HLEN        14
+#endif
+#ifndef ETH_P_IP
+#define ETH_P_IP        0x0800
+#endif
+#ifndef ETH_P_IPV6
+#define ETH_P_IPV6      0x86DD
+#endif
+#ifndef ETH_P_8021Q
+#define ETH_P_8021Q     0x8100
+#endif
+#ifndef ETH_P_8021AD
+#define ETH_P_8021AD    0x88A8
+#endif
+
+/* From IONetworkController.h */
+enum {
+    kChecksumIP         = 0x0001,
+    kChecksumTCP        = 0x0002,
+    kChecksumUDP        = 0x0004,
+    kChecksumTCPIPv6    = 0x0020,
+    kChecksumUDPIPv6    = 0x0040
+};
+
+/* From kpi_mbuf.h */
+#define MBUF_TSO_IPV4   0x00000001
+#define MBUF_TSO_IPV6   0x00000002
+
+struct HostMbuf {
+    struct HostMbuf *next;
+    UInt8 *buffer;
+    UInt8 *data;
+    size_t len;
+    size_t size;
+    size_t pktLen;      /* valid in the first mbuf only */
+};
+
+typedef struct HostMbuf *mbuf_t;
+
+mbuf_t hostMbufAlloc(size_t size);
+mbuf_t hostMbufChain(const UInt8 *data, size_t len, const size_t *chunks, UInt32 numChunks);
+void hostMbufFree(mbuf_t m);
+UInt32 hostMbufSegments(mbuf_t m, IOPhysicalSegment *segments, UInt32 maxSegs);
+
+size_t mbuf_len(mbuf_t m);
+void *mbuf_data(mbuf_t m);
+size_t mbuf_pkthdr_len(mbuf_t m);
+errno_t mbuf_copydata(mbuf_t m, size_t offset, size_t len, void *out);
+errno_t mbuf_pullup(mbuf_t *m, size_t len);
+
+extern "C" {
+    #include "hw.h"
+}
+
+#endif /* HostStubs_h */
@@ -0,0 +1,116 @@
+/* TestPackets.cpp -- Packets for the host tests and benchmarks of IntelMausi.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#include "TestPackets.h"
+
+/* Build an ethernet frame according to spec. */
+std::vector<UInt8> buildPacket(const struct PacketSpec *spec)
+{
+    std::vector<UInt8> pkt;
+    UInt32 l3Len = spec->ipv6 ? (sizeof(struct ip6_hdr) + spec->extHdrLen) : (sizeof(struct ip) + spec->ipOptLen);
+    UInt32 l4Len = spec->udp ? sizeof(struct udphdr) : (sizeof(struct tcphdr) + spec->tcpOptLen);
+    UInt8 l4Proto = spec->udp ? (UInt8)IPPROTO_UDP : (UInt8)IPPROTO_TCP;
+    UInt32 offset;
+    UInt32 i;
+
+    pkt.resize(ETH_HLEN + (spec->vlan ? kVlanHdrLen : 0) + l3Len + l4Len + spec->payloadLen);
+
+    for (i = 0; i < 12; i++)
+        pkt[i] = 0x10 + i;
+
+    offset = 12;
+
+    if (spec->vlan) {
+        pkt[offset++] = ETH_P_8021Q >> 8;
+        pkt[offset++] = ETH_P_8021Q & 0xff;
+        pkt[offset++] = 0x00;
+        pkt[offset++] = 0x05;
+    }
+    pkt[offset++] = (spec->ipv6 ? ETH_P_IPV6 : ETH_P_IP) >> 8;
+    pkt[offset++] = (spec->ipv6 ? ETH_P_IPV6 : ETH_P_IP) & 0xff;
+
+    if (spec->ipv6) {
+        struct ip6_hdr *ip6 = (struct ip6_hdr *)&pkt[offset];
+
+        ip6->ip6_flow = htonl(0x60000000);
+        ip6->ip6_plen = htons(spec->extHdrLen + l4Len + spec->payloadLen);
+        ip6->ip6_nxt = spec->extHdrLen ? (UInt8)IPPROTO_HOPOPTS : l4Proto;
+        ip6->ip6_hlim = 64;
+
+        for (i = 0; i < 16; i++) {
+            ip6->ip6_src.s6_addr[i] = 0x20 + i;
+            ip6->ip6_dst.s6_addr[i] = 0xa0 + i;
+        }
+        offset += sizeof(struct ip6_hdr);
+
+        if (spec->extHdrLen) {
+            pkt[offset] = l4Proto;
+            pkt[offset + 1] = (spec->extHdrLen >> 3) - 1;
+            offset += spec->extHdrLen;
+        }
+    } else {
+        struct ip *ip = (struct ip *)&pkt[offset];
+
+        ip->ip_v = 4;
+        ip->ip_hl = l3Len >> 2;
+        ip->ip_len = htons(l3Len + l4Len + spec->payloadLen);
+        ip->ip_ttl = 64;
+        ip->ip_p = l4Proto;
+        ip->ip_sum = htons(0x1234);
+        ip->ip_src.s_addr = htonl(0x0a000001);
+        ip->ip_dst.s_addr = htonl(0x0a000002);
+
+        /* NOP options */
+        memset(&pkt[offset + sizeof(struct ip)], 1, spec->ipOptLen);
+        offset += l3Len;
+    }
+    if (spec->udp) {
+        struct udphdr *udp = (struct udphdr *)&pkt[offset];
+
+        udp->uh_sport = htons(5001);
+        udp->uh_dport = htons(53);
+        udp->uh_ulen = htons(l4Len + spec->payloadLen);
+        udp->uh_sum = htons(0xbeef);
+    } else {
+        struct tcphdr *tcp = (struct tcphdr *)&pkt[offset];
+
+        tcp->th_sport = htons(5001);
+        tcp->th_dport = htons(80);
+        tcp->th_off = l4Len >> 2;
+        tcp->th_flags = TH_ACK;
+        tcp->th_sum = htons(0xbeef);
+        memset(&pkt[offset + sizeof(struct tcphdr)], 1, spec->tcpOptLen);
+    }
+    offset += l4Len;
+
+    for (i = offset; i < pkt.size(); i++)
+        pkt[i] = (UInt8)i;
+
+    return pkt;
+}
+
+/* The pseudo header checksum of TCP without the length. */
+UInt16 pseudoCSum(const UInt8 *addrs, UInt32 len)
+{
+    UInt32 sum = IPPROTO_TCP;
+    UInt32 i;
+
+    for (i = 0; i < len; i += 2)
+        sum += (addrs[i] << 8) | addrs[i + 1];
+
+    while (sum >> 16)
+        sum = (sum >> 16) + (sum & 0xffff);
+
+    return (UInt16)sum;
+}
+
@@ -0,0 +1,37 @@
+/* TestPackets.h -- Packets for the host tests and benchmarks of IntelMausi.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#ifndef TestPackets_h
+#define TestPackets_h
+
+#include <vector>
+
+#include "HostStubs.h"
+#include "IntelMausiRing.h"
+
+struct PacketSpec {
+    bool ipv6;
+    bool vlan;
+    UInt32 ipOptLen;        /* IPv4 options */
+    UInt32 extHdrLen;       /* IPv6 hop-by-hop options header */
+    UInt32 tcpOptLen;
+    UInt32 payloadLen;
+    bool udp;               /* UDP instead of TCP */
+};
+
+std::vector<UInt8> buildPacket(const struct PacketSpec *spec);
+
+/* The pseudo header checksum of TCP without the length. */
+UInt16 pseudoCSum(const UInt8 *addrs, UInt32 len);
+
+#endif /* TestPackets_h */
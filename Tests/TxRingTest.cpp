@@ -0,0 +1,294 @@
+/* TxRingTest.cpp -- Simulated tx ring test of IntelMausi's TSO setup.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Large IPv4/IPv6 sends are run through the descriptor setup of the driver
+ * and written into a ring on the heap the way intelFillTxDescs() does it.
+ * The context and data descriptors are checked against the headers. The
+ * checksum offload setup of each class is checked as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HostStubs.h"
+#include "TestPackets.h"
+#include "IntelMausiRing.h"
+
+#define kRingSize       256
+#define kFifoLimit      8192
+#define kMaxSegs        40
+#define kMaxSplitSegs   8
+#define kMss            1448
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__, __func__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+/* A simulated tx ring, filled like intelFillTxDescs() does. */
+struct SimRing {
+    struct e1000_data_desc descs[kRingSize];
+    UInt32 next;
+};
+
+static void setupInit(struct intelTxDescSetup *setup)
+{
+    memset(setup, 0, sizeof(*setup));
+    setup->opts = (E1000_TXD_CMD_IDE | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS);
+}
+
+/* Returns the number of descriptors used. */
+static UInt32 ringFill(struct SimRing *ring, struct intelTxDescSetup *setup, IOPhysicalSegment *segments, UInt32 numSegs)
+{
+    UInt32 index = ring->next;
+    UInt32 i;
+
+    if (setup->numDescs) {
+        intelTxWriteContext((struct e1000_context_desc *)&ring->descs[index], setup);
+        index = (index + 1) % kRingSize;
+    }
+    for (i = 0; i < numSegs; i++) {
+        intelTxWriteData(&ring->descs[index], setup, &segments[i], (i == (numSegs - 1)) ? setup->opts : 0);
+        index = (index + 1) % kRingSize;
+    }
+    ring->next = index;
+
+    return setup->numDescs + numSegs;
+}
+
+static void testTSO(const struct PacketSpec *spec, const size_t *chunks, UInt32 numChunks)
+{
+    std::vector<UInt8> pkt = buildPacket(spec);
+    std::vector<UInt8> sent;
+    std::vector<UInt8> expected;
+    IOPhysicalSegment segments[kMaxSegs + kMaxSplitSegs];
+    struct intelTxDescSetup setup;
+    struct SimRing *ring = (struct SimRing *)calloc(1, sizeof(struct SimRing));
+    struct e1000_context_desc *ctx;
+    struct e1000_data_desc *desc;
+    mbuf_t m = hostMbufChain(&pkt[0], pkt.size(), chunks, numChunks);
+    UInt32 tsoFlags = spec->ipv6 ? MBUF_TSO_IPV6 : MBUF_TSO_IPV4;
+    UInt32 l3Len = spec->ipv6 ? sizeof(struct ip6_hdr) : (sizeof(struct ip) + spec->ipOptLen);
+    UInt32 l4Offset = ETH_HLEN + l3Len;
+    UInt32 hdrLen = l4Offset + sizeof(struct tcphdr) + spec->tcpOptLen;
+    UInt32 numSegs;
+    UInt32 numDescs;
+    UInt32 word1;
+    UInt32 i;
+
+    /* Start in the middle so that the ring wraps around. */
+    ring->next = kRingSize - 3;
+
+    setupInit(&setup);
+    CHECK(intelTxSetupTSO(&m, tsoFlags, kMss, &setup) == kTxSetupDone);
+    CHECK(setup.tso && (setup.numDescs == 1));
+
+    numSegs = hostMbufSegments(m, segments, kMaxSegs);
+    CHECK(numSegs > 0);
+    numSegs = intelTxSplitSegments(segments, numSegs, kMaxSegs + kMaxSplitSegs, kFifoLimit);
+    CHECK(numSegs > 0);
+
+    numDescs = ringFill(ring, &setup, segments, numSegs);
+    CHECK(numDescs == (numSegs + 1));
+
+    /* The context descriptor. */
+    ctx = (struct e1000_context_desc *)&ring->descs[kRingSize - 3];
+
+    CHECK(ctx->upper_setup.tcp_fields.tucss == l4Offset);
+    CHECK(ctx->upper_setup.tcp_fields.tucso == (l4Offset + offsetof(struct tcphdr, th_sum)));
+    CHECK(ctx->upper_setup.tcp_fields.tucse == 0);
+    CHECK(ctx->tcp_seg_setup.fields.hdr_len == hdrLen);
+    CHECK(ctx->tcp_seg_setup.fields.mss == kMss);
+    CHECK(ctx->tcp_seg_setup.fields.status == 0);
+    CHECK((ctx->cmd_and_length & 0x000fffff) == (pkt.size() - hdrLen));
+    CHECK((ctx->cmd_and_length & E1000_TXD_CMD_DEXT) && (ctx->cmd_and_length & E1000_TXD_CMD_TSE));
+    CHECK(ctx->cmd_and_length & E1000_TXD_CMD_TCP);
+    CHECK(!(ctx->cmd_and_length & E1000_TXD_DTYP_D));
+
+    if (spec->ipv6) {
+        CHECK(ctx->lower_setup.ip_config == ETH_HLEN);
+        CHECK(!(ctx->cmd_and_length & E1000_TXD_CMD_IP));
+    } else {
+        CHECK(ctx->lower_setup.ip_fields.ipcss == ETH_HLEN);
+        CHECK(ctx->lower_setup.ip_fields.ipcso == (ETH_HLEN + offsetof(struct ip, ip_sum)));
+        CHECK((UInt16)ctx->lower_setup.ip_fields.ipcse == (l4Offset - 1));
+        CHECK(ctx->cmd_and_length & E1000_TXD_CMD_IP);
+    }
+
+    /* The data descriptors must cover the packet without exceeding the fifo limit. */
+    for (i = 0; i < numSegs; i++) {
+        desc = &ring->descs[(kRingSize - 2 + i) % kRingSize];
+        word1 = desc->lower.data;
+
+        CHECK((word1 & 0x000fffff) <= kFifoLimit);
+        CHECK((word1 & (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D | E1000_TXD_CMD_TSE)) ==
+              (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D | E1000_TXD_CMD_TSE));
+        CHECK(((word1 & E1000_TXD_CMD_EOP) != 0) == (i == (numSegs - 1)));
+        CHECK((UInt32)desc->upper.data == (spec->ipv6 ? E1000_TXD_OPTS_TXSM : (E1000_TXD_OPTS_TXSM | E1000_TXD_OPTS_IXSM)));
+
+        sent.insert(sent.end(), (UInt8 *)(uintptr_t)desc->buffer_addr,
+                    (UInt8 *)(uintptr_t)desc->buffer_addr + (word1 & 0x000fffff));
+    }
+    CHECK(ring->next == ((kRingSize - 3 + numDescs) % kRingSize));
+    CHECK(sent.size() == pkt.size());
+
+    /* The headers as the hardware expects them. */
+    expected = pkt;
+
+    if (spec->ipv6) {
+        struct ip6_hdr *ip6 = (struct ip6_hdr *)&expected[ETH_HLEN];
+
+        ip6->ip6_plen = 0;
+        ((struct tcphdr *)&expected[l4Offset])->th_sum = htons(pseudoCSum((UInt8 *)&ip6->ip6_src, 32));
+    } else {
+        struct ip *ip = (struct ip *)&expected[ETH_HLEN];
+
+        ip->ip_len = 0;
+        ip->ip_sum = 0;
+        ((struct tcphdr *)&expected[l4Offset])->th_sum = htons(pseudoCSum((UInt8 *)&ip->ip_src, 8));
+    }
+    CHECK(sent == expected);
+
+    hostMbufFree(m);
+    free(ring);
+}
+
+static void testUnsupported(const struct PacketSpec *spec)
+{
+    std::vector<UInt8> pkt = buildPacket(spec);
+    struct intelTxDescSetup setup;
+    mbuf_t m = hostMbufChain(&pkt[0], pkt.size(), NULL, 0);
+    UInt32 tsoFlags = spec->ipv6 ? MBUF_TSO_IPV6 : MBUF_TSO_IPV4;
+
+    setupInit(&setup);
+    CHECK(intelTxSetupTSO(&m, tsoFlags, kMss, &setup) == kTxSetupUnsupported);
+    CHECK(!setup.tso && !setup.numDescs);
+    CHECK((m->len == pkt.size()) && !memcmp(m->data, &pkt[0], pkt.size()));
+
+    hostMbufFree(m);
+}
+
+/* A TCP header claiming more options than the packet holds. */
+static void testTruncated()
+{
+    struct PacketSpec spec = { false, false, 0, 0, 0, 0, false };
+    std::vector<UInt8> pkt = buildPacket(&spec);
+    struct intelTxDescSetup setup;
+    size_t chunks[] = { ETH_HLEN + sizeof(struct ip) };
+    mbuf_t m;
+
+    ((struct tcphdr *)&pkt[ETH_HLEN + sizeof(struct ip)])->th_off = 15;
+    m = hostMbufChain(&pkt[0], pkt.size(), chunks, 1);
+
+    setupInit(&setup);
+    CHECK(intelTxSetupTSO(&m, MBUF_TSO_IPV4, kMss, &setup) == kTxSetupDropped);
+    CHECK(m == NULL);
+}
+
+/* The class with the other transport protocol. */
+static const UInt32 otherL4Class[kTxOffloadCount] = {
+    kTxOffloadNone, kTxOffloadUDPv4, kTxOffloadTCPv4, kTxOffloadIPv4, kTxOffloadUDPv6, kTxOffloadTCPv6
+};
+
+/* Checksum offload of a small packet through the setup function of its class. */
+static void testCsum(const struct PacketSpec *spec, UInt32 offloadFlags, UInt32 l3Offset, UInt32 l4Offset)
+{
+    std::vector<UInt8> pkt = buildPacket(spec);
+    struct intelTxDescSetup setup;
+    mbuf_t m = hostMbufChain(&pkt[0], pkt.size(), NULL, 0);
+    UInt32 offloadClass = intelTxOffloadClass(offloadFlags);
+    const struct intelTxOffloadInfo *info = &txOffloadInfo[offloadClass];
+    UInt32 l3Found = 0;
+
+    setupInit(&setup);
+    CHECK(txSetupFuncs[offloadClass](m, &setup, &l3Found) == kTxSetupDone);
+    CHECK(l3Found == l3Offset);
+    CHECK(setup.cmd == (E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D));
+    CHECK(setup.cmdLen == info->cmdLen);
+    CHECK(setup.word2 == info->word2);
+
+    if (spec->ipv6)
+        CHECK(setup.ipConfig == l3Offset);
+    else
+        CHECK(setup.ipConfig == (((l4Offset - 1) << 16) | ((l3Offset + offsetof(struct ip, ip_sum)) << 8) | l3Offset));
+
+    if (info->l4Proto)
+        CHECK(setup.tcpConfig == (((l4Offset + info->l4CSumOffset) << 8) | l4Offset));
+    else
+        CHECK(setup.tcpConfig == 0);
+
+    /* A mismatching transport protocol is left to the software. */
+    if (info->l4Proto) {
+        offloadClass = otherL4Class[offloadClass];
+        CHECK(txSetupFuncs[offloadClass](m, &setup, &l3Found) == kTxSetupUnsupported);
+    }
+    hostMbufFree(m);
+}
+
+static void testSplitOverflow()
+{
+    IOPhysicalSegment segments[4] = {
+        { 0x10000, 3 * kFifoLimit },
+        { 0x40000, 100 },
+        { 0x50000, kFifoLimit + 1 },
+        { 0, 0 }
+    };
+    IOPhysicalSegment split[8];
+
+    CHECK(intelTxSplitSegments(segments, 3, 4, kFifoLimit) == 0);
+
+    memcpy(split, segments, sizeof(segments));
+    CHECK(intelTxSplitSegments(split, 3, 8, kFifoLimit) == 6);
+    CHECK((split[0].location == 0x10000) && (split[2].location == (0x10000 + 2 * kFifoLimit)));
+    CHECK((split[3].location == 0x40000) && (split[3].length == 100));
+    CHECK((split[4].length == kFifoLimit) && (split[5].location == (0x50000 + kFifoLimit)) && (split[5].length == 1));
+}
+
+int main(int argc, const char *argv[])
+{
+    /* Headers split inside the IPv4 options, payload in 16k chunks. */
+    struct PacketSpec v4Opts = { false, false, 8, 0, 12, 60000, false };
+    size_t v4Chunks[] = { ETH_HLEN + sizeof(struct ip) + 4, 40, 16384, 16384, 16384 };
+    struct PacketSpec v4 = { false, false, 0, 0, 0, 64000, false };
+    size_t v4Chunks2[] = { 2048, 2048, 2048, 2048, 2048, 2048, 2048, 2048, 32768 };
+    struct PacketSpec v6 = { true, false, 0, 0, 12, 60000, false };
+    size_t v6Chunks[] = { 30, 60, 24000, 24000 };
+    struct PacketSpec v4Vlan = { false, true, 0, 0, 0, 30000, false };
+    struct PacketSpec v6Ext = { true, false, 0, 8, 0, 30000, false };
+    struct PacketSpec v4Udp = { false, true, 0, 0, 0, 1000, true };
+    struct PacketSpec v6Udp = { true, false, 0, 0, 0, 1000, true };
+
+    testTSO(&v4Opts, v4Chunks, sizeof(v4Chunks) / sizeof(v4Chunks[0]));
+    testTSO(&v4, v4Chunks2, sizeof(v4Chunks2) / sizeof(v4Chunks2[0]));
+    testTSO(&v6, v6Chunks, sizeof(v6Chunks) / sizeof(v6Chunks[0]));
+    testUnsupported(&v4Vlan);
+    testUnsupported(&v6Ext);
+    testTruncated();
+    testCsum(&v4Opts, kChecksumTCP | kChecksumIP, ETH_HLEN, ETH_HLEN + 28);
+    testCsum(&v4Udp, kChecksumUDP | kChecksumIP, ETH_HLEN + kVlanHdrLen, ETH_HLEN + kVlanHdrLen + 20);
+    testCsum(&v4Vlan, kChecksumIP, ETH_HLEN + kVlanHdrLen, ETH_HLEN + kVlanHdrLen + 20);
+    testCsum(&v6Ext, kChecksumTCPIPv6, ETH_HLEN, ETH_HLEN + 48);
+    testCsum(&v6Udp, kChecksumUDPIPv6, ETH_HLEN, ETH_HLEN + 40);
+    testSplitOverflow();
+
+    if (failures) {
+        fprintf(stderr, "TxRingTest: %d check(s) failed.\n", failures);
+        return 1;
+    }
+    printf("TxRingTest: all checks passed.\n");
+
+    return 0;
+}